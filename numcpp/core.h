@@ -2,15 +2,25 @@
 #define NUMCPP_CORE_H
 
 #include "core/utils.h"
+#include "core/parallel.h"
 #include "core/manager.h"
 #include "core/array.h"
 #include "core/arrayref.h"
 #include "core/initialization.h"
+#include "core/arrayview.h"
 // #include "core/constants.h"
 #include "core/iterator.h"
 #include "core/itertools.h"
 #include "core/functions.h"
+#include "core/half.h"
+#include "core/cast.h"
+#include "core/planar.h"
+#include "core/stacking.h"
+#include "core/mask.h"
+#include "core/indexing.h"
+#include "core/bitmask.h"
 #include "core/ostream.h"
+#include "core/cowarray.h"
 
 /*!
 @defgroup core Core
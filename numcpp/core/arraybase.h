@@ -2,6 +2,8 @@
 #ifndef NUMCPP_ARRAYBASE_H
 #define NUMCPP_ARRAYBASE_H
 
+#include <type_traits>
+
 #include "arraycore.h"
 #include "index.h"
 
@@ -12,6 +14,20 @@ template<class T> class Array;
 template<class T> class ArrayRef;
 template<typename T> class Iterator;
 template<typename T, typename Derived> class SliceIterator;
+template<typename T> class ArrayView;
+template<typename T> class MaskedArray;
+template<typename T> class BitMaskedArray;
+class BitMask;
+
+namespace detail
+{
+    template<typename... Is>
+    struct all_integral : std::true_type {};
+    
+    template<typename I, typename... Is>
+    struct all_integral<I, Is...>
+        : std::integral_constant<bool, std::is_integral<I>::value && all_integral<Is...>::value> {};
+}
 
 template <typename DT, typename Derived>
 class ArrayBase
@@ -67,15 +83,37 @@ public:
     }
     
     template<typename... Is>
-    DT& operator()(Is... is) const
+    typename std::enable_if<detail::all_integral<Is...>::value, DT&>::type
+    operator()(Is... is) const
     {
         std::ptrdiff_t offset = _core.offset(is...);
         return *reinterpret_cast<DT*>(_data + offset);
     }
     
+    // Indexing with any combination of integers, slices and newaxis returns
+    // a view that keeps the buffer alive. No heap allocation takes place.
+    template<typename... Is>
+    typename std::enable_if<!detail::all_integral<Is...>::value, ArrayView<DT> >::type
+    operator()(const Is&... is) const;
+    
+    // Same as operator(), but the view does not keep the buffer alive and
+    // touches no reference count.
+    template<typename... Is>
+    ArrayView<DT> view(const Is&... is) const;
+    
     ArrayRef<DT> operator[](int index) const
     {
-        return operator[](std::vector<Index>{index});
+        if(ndims() == 0)
+            throw std::invalid_argument("the index has more elements than array dimensions");
+        
+        if(index < 0)
+            index += shape()[0];
+        
+        assert((index >= 0 && size_t(index) < shape()[0]) && "index out of range");
+        
+        return ArrayRef<DT>(ArrayCore(Shape(shape().begin() + 1, shape().end()),
+            Strides(strides().begin() + 1, strides().end()),
+            manager(), offset() + index * strides()[0]));
     }
     
     ArrayRef<DT> operator[](const std::vector<Index>& index) const
@@ -139,6 +177,22 @@ public:
         return ArrayRef<DT>(ArrayCore(newShape, newStrides, manager(), newOffset));
     }
     
+    // Elements selected by a boolean mask of the same shape, as a new 1-D
+    // array. Defined in mask.h.
+    Array<DT> operator[](const Array<bool>& mask) const;
+    
+    // Rows (elements along the first axis) at the given indices, as a new
+    // array. Defined in indexing.h.
+    Array<DT> operator[](const Array<size_t>& indices) const;
+    
+    // Assignment target for the elements selected by mask:
+    // arr.masked(mask) = value. Defined in mask.h.
+    MaskedArray<DT> masked(const Array<bool>& mask) const;
+    
+    // Same with bit-packed masks. Defined in bitmask.h.
+    Array<DT> operator[](const BitMask& mask) const;
+    BitMaskedArray<DT> masked(const BitMask& mask) const;
+    
     Array<DT> T()
     {
         Shape newShape(shape());
@@ -155,20 +209,23 @@ public:
     slice_iterator slice_begin(int axis) const;
     slice_iterator slice_end(int axis) const;
     
+    // Contiguous iterators walk the elements in memory order. This is the
+    // logical (C) order for C-contiguous arrays, and it is accepted for
+    // F-contiguous arrays too when the element order does not matter.
     contiguous_iterator cont_begin() const
     {
-        if(!isContiguous())
+        if(!isDense())
             throw std::invalid_argument("cannot create a contiguous_iterator; array is not contiguous");
         
-        return data() + offset();
+        return reinterpret_cast<DT*>(_data + offset());
     }
     
     contiguous_iterator cont_end() const
     {
-        if(!isContiguous())
+        if(!isDense())
             throw std::invalid_argument("cannot create a contiguous_iterator; array is not contiguous");
         
-        return data() + offset() + numElements();
+        return reinterpret_cast<DT*>(_data + offset()) + numElements();
     }
     
     int numElements() const {return _core.numElements();}
@@ -176,6 +233,7 @@ public:
     const Strides& strides() const {return _core.strides();}
     int ndims() const {return _core.ndims();}
     Manager::Ptr manager() const {return _core.manager();}
+    long useCount() const {return _core.useCount();}
     bool isNull() const {return _core.isNull();}
     size_t length() const {return _core.ndims() > 0 ? _core.shape()[0] : 0 ;}
     
@@ -204,6 +262,31 @@ public:
         return true;
     }
     
+    bool isFContiguous() const
+    {
+        size_t value = sizeof(DT);
+        
+        auto strides_it = strides().begin();
+        auto strides_it_end = strides().end();
+        auto shape_it = shape().begin();
+        for(; strides_it != strides_it_end; ++strides_it, ++shape_it)
+        {
+            if(*strides_it != std::ptrdiff_t(value))
+                return false;
+            
+            value *= *shape_it;
+        }
+        
+        return true;
+    }
+    
+    // Contiguous in either C or Fortran order.
+    bool isDense() const {return isContiguous() || isFContiguous();}
+    
+    // Layout of a dense array: Order::F only for F-contiguous arrays that
+    // are not C-contiguous.
+    Order order() const {return !isContiguous() && isFContiguous() ? Order::F : Order::C;}
+    
     std::tuple<int,int,int> getInnerLoopAxisAndStep() const
     {
         int axis = ndims() - 1;
@@ -277,4 +360,6 @@ typename ArrayBase<T, Derived>::slice_iterator ArrayBase<T, Derived>::slice_end(
 
 }
 
+#include "arrayview.h"
+
 #endif
@@ -15,14 +15,14 @@ public:
     ArrayCore()
     {}
     
-    ArrayCore(const Shape& shape,
-        const Strides& strides,
-        const Manager::Ptr manager,
+    ArrayCore(Shape shape,
+        Strides strides,
+        Manager::Ptr manager,
         std::ptrdiff_t offset=0)
-        : _shape(shape)
-        , _strides(strides)
+        : _shape(std::move(shape))
+        , _strides(std::move(strides))
         , _offset(offset)
-        , _manager(manager)
+        , _manager(std::move(manager))
     {
         if(_shape.size() != _strides.size())
             throw std::invalid_argument("strides and shape must have the same size");
@@ -50,12 +50,15 @@ public:
     int ndims() const {return _shape.size();}
     
     Manager::Ptr manager() const {return _manager;}
+    long useCount() const {return _manager.use_count();}
     
     unsigned char* data() const {return (bool)_manager ? _manager->data() : 0;}
     
     template<int Index=0>
     std::ptrdiff_t offset() const {return _offset;}
     
+    void setOffset(std::ptrdiff_t offset) {_offset = offset;}
+    
     std::ptrdiff_t offset(const std::vector<size_t>& index) const
     {
         #ifndef NDEBUG
@@ -35,6 +35,12 @@ public:
     {
         Array<T> arr = broadcast(rhs, this->shape());
         
+        if(detail::hasUnitInnerStride(*this) && detail::hasUnitInnerStride(arr))
+        {
+            detail::copy_rows(*this, arr);
+            return *this;
+        }
+        
         for(auto elems : zip(*this, arr))
             std::get<0>(elems) = std::get<1>(elems);
         
@@ -0,0 +1,419 @@
+
+#ifndef NUMCPP_ARRAYVIEW_H
+#define NUMCPP_ARRAYVIEW_H
+
+#include <array>
+#include <type_traits>
+
+#include "arraybase.h"
+
+namespace numcpp
+{
+
+// Maximum number of dimensions of an ArrayView.
+constexpr int maxViewDims = 8;
+
+namespace detail
+{
+    // Call f(ptrs, n) for every innermost row of a strided ndims-dimensional
+    // region, with ptrs pointing to the start of the row of each operand and
+    // n the row length. strides[k] points to the byte strides of the k-th
+    // operand. At most maxViewDims dimensions are supported; callers fall
+    // back to Iterator for more.
+    template<size_t N, typename Function>
+    void strided_for_each_row(int ndims, const size_t* shape,
+        std::array<unsigned char*, N> ptrs,
+        const std::array<const std::ptrdiff_t*, N>& strides,
+        Function&& f)
+    {
+        if(ndims > maxViewDims)
+            throw std::invalid_argument("too many dimensions for a strided loop");
+        
+        for(int i = 0; i < ndims; ++i)
+            if(shape[i] == 0)
+                return;
+        
+        if(ndims == 0)
+        {
+            f(ptrs, 1);
+            return;
+        }
+        
+        const int inner = ndims - 1;
+        const size_t innerSize = shape[inner];
+        
+        size_t counter[maxViewDims] = {0};
+        while(true)
+        {
+            f(ptrs, innerSize);
+            
+            int i = inner - 1;
+            for(; i >= 0; --i)
+            {
+                for(size_t k = 0; k < N; ++k)
+                    ptrs[k] += strides[k][i];
+                
+                if(++counter[i] < shape[i])
+                    break;
+                
+                for(size_t k = 0; k < N; ++k)
+                    ptrs[k] -= strides[k][i] * shape[i];
+                counter[i] = 0;
+            }
+            
+            if(i < 0)
+                return;
+        }
+    }
+    
+    // Call f(ptrs) for every element of a strided ndims-dimensional region.
+    template<size_t N, typename Function>
+    void strided_for_each(int ndims, const size_t* shape,
+        std::array<unsigned char*, N> ptrs,
+        const std::array<const std::ptrdiff_t*, N>& strides,
+        Function&& f)
+    {
+        std::array<std::ptrdiff_t, N> innerStrides;
+        for(size_t k = 0; k < N; ++k)
+            innerStrides[k] = ndims > 0 ? strides[k][ndims-1] : 0;
+        
+        strided_for_each_row<N>(ndims, shape, ptrs, strides,
+            [&f, &innerStrides](std::array<unsigned char*, N> p, size_t n)
+            {
+                for(size_t j = 0; j < n; ++j)
+                {
+                    f(p);
+                    for(size_t k = 0; k < N; ++k)
+                        p[k] += innerStrides[k];
+                }
+            });
+    }
+    
+    // Whether the innermost axis of the array is unit-strided, so that the
+    // array can be processed row by row.
+    template<typename T, typename Derived>
+    bool hasUnitInnerStride(const ArrayBase<T, Derived>& arr)
+    {
+        return arr.ndims() >= 1 && arr.ndims() <= maxViewDims
+            && arr.strides().back() == std::ptrdiff_t(sizeof(T));
+    }
+    
+    template<typename T, typename Derived>
+    unsigned char* firstByte(const ArrayBase<T, Derived>& arr)
+    {
+        return reinterpret_cast<unsigned char*>(arr.data()) + arr.offset();
+    }
+    
+    // Copy between two arrays of the same shape with unit inner strides.
+    template<typename T, typename D1, typename D2>
+    void copy_rows(const ArrayBase<T, D1>& dst, const ArrayBase<T, D2>& src)
+    {
+        strided_for_each_row<2>(dst.ndims(), dst.shape().data(),
+            {{firstByte(dst), firstByte(src)}},
+            {{dst.strides().data(), src.strides().data()}},
+            [](const std::array<unsigned char*, 2>& p, size_t n)
+            {
+                const T* in = reinterpret_cast<const T*>(p[1]);
+                std::copy(in, in + n, reinterpret_cast<T*>(p[0]));
+            });
+    }
+}
+
+/// Non-owning view of strided data.
+///
+/// An ArrayView holds a raw pointer, the shape and the strides (in bytes) of
+/// the data, all stored inline. Building, copying or destroying a view never
+/// allocates, so it is meant for temporary views inside hot functions. Views
+/// returned by operator() of an array also hold its manager, which keeps the
+/// buffer alive at the cost of a reference count; the other views (view(),
+/// conversions, raw memory) touch no reference count and the viewed memory
+/// must outlive them. Use ArrayView<const T> for read-only views.
+template<typename T>
+class ArrayView
+{
+public:
+    typedef T value_type;
+    typedef T& reference;
+    typedef T* pointer;
+    typedef typename std::remove_const<T>::type nonconst_value_type;
+
+    ArrayView()
+        : _data(nullptr), _ndims(0)
+    {}
+
+    template<typename Derived>
+    ArrayView(const ArrayBase<nonconst_value_type, Derived>& array)
+        : _data(reinterpret_cast<unsigned char*>(array.data()) + array.offset())
+        , _ndims(array.ndims())
+    {
+        if(array.isNull())
+            _data = nullptr;
+
+        setLayout(array.shape().data(), array.strides().data());
+    }
+
+    // Allow ArrayView<T> -> ArrayView<const T>.
+    template<typename U, typename = typename std::enable_if<
+        std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+    ArrayView(const ArrayView<U>& view)
+        : _data(view.bytes())
+        , _ndims(view.ndims())
+        , _owner(view.owner())
+    {
+        setLayout(view.shapeData(), view.stridesData());
+    }
+
+    // Contiguous 1-D view of a vector.
+    template<typename Alloc>
+    ArrayView(const std::vector<nonconst_value_type, Alloc>& vec)
+        : _data(reinterpret_cast<unsigned char*>(const_cast<nonconst_value_type*>(vec.data())))
+        , _ndims(1)
+    {
+        static_assert(std::is_const<T>::value, "a std::vector can only be viewed as ArrayView<const T>");
+        _shape[0] = vec.size();
+        _strides[0] = sizeof(T);
+    }
+
+    // Contiguous view of raw memory.
+    ArrayView(T* data, std::initializer_list<size_t> shape)
+        : _data(reinterpret_cast<unsigned char*>(const_cast<nonconst_value_type*>(data)))
+        , _ndims(shape.size())
+    {
+        if(_ndims > maxViewDims)
+            throw std::invalid_argument("too many dimensions for an ArrayView");
+
+        std::copy(shape.begin(), shape.end(), _shape);
+        std::ptrdiff_t stride = sizeof(T);
+        for(int i = _ndims - 1; i >= 0; --i)
+        {
+            _strides[i] = stride;
+            stride *= _shape[i];
+        }
+    }
+
+    ArrayView(T* data, int ndims, const size_t* shape, const std::ptrdiff_t* strides)
+        : _data(reinterpret_cast<unsigned char*>(const_cast<nonconst_value_type*>(data)))
+        , _ndims(ndims)
+    {
+        setLayout(shape, strides);
+    }
+
+    // View that keeps the buffer of owner alive.
+    ArrayView(const ArrayView& view, Manager::Ptr owner)
+        : ArrayView(view)
+    {
+        _owner = std::move(owner);
+    }
+
+    template<typename... Is>
+    T& operator()(Is... is) const
+    {
+        return *reinterpret_cast<T*>(_data + offset<0>(is...));
+    }
+
+    int ndims() const {return _ndims;}
+    size_t shape(int axis) const {return _shape[axis];}
+    std::ptrdiff_t strides(int axis) const {return _strides[axis];}
+    const size_t* shapeData() const {return _shape;}
+    const std::ptrdiff_t* stridesData() const {return _strides;}
+
+    /// Pointer to the first element (the offset is already applied).
+    T* data() const {return reinterpret_cast<T*>(_data);}
+    unsigned char* bytes() const {return _data;}
+    bool isNull() const {return _data == nullptr;}
+    const Manager::Ptr& owner() const {return _owner;}
+
+    size_t numElements() const
+    {
+        size_t res = 1;
+        for(int i = 0; i < _ndims; ++i)
+            res *= _shape[i];
+        return res;
+    }
+
+    bool isContiguous() const
+    {
+        std::ptrdiff_t value = sizeof(T);
+        for(int i = _ndims - 1; i >= 0; --i)
+        {
+            if(_strides[i] != value)
+                return false;
+            value *= _shape[i];
+        }
+        return true;
+    }
+
+    template<typename Function>
+    void for_each(Function&& f) const
+    {
+        detail::strided_for_each<1>(_ndims, _shape, {{_data}}, {{_strides}},
+            [&f](const std::array<unsigned char*, 1>& p){f(*reinterpret_cast<T*>(p[0]));});
+    }
+
+private:
+    void setLayout(const size_t* shape, const std::ptrdiff_t* strides)
+    {
+        if(_ndims > maxViewDims)
+            throw std::invalid_argument("too many dimensions for an ArrayView");
+
+        std::copy(shape, shape + _ndims, _shape);
+        std::copy(strides, strides + _ndims, _strides);
+    }
+
+    template<int Index>
+    std::ptrdiff_t offset() const {return 0;}
+
+    template<int Index, typename... Is>
+    std::ptrdiff_t offset(size_t i, Is... is) const
+    {
+        assert(Index < _ndims && "view indexed with too many indices");
+        assert(i < _shape[Index] && "index out of range");
+        return i*_strides[Index] + offset<Index+1>(is...);
+    }
+
+    unsigned char* _data;
+    int _ndims;
+    size_t _shape[maxViewDims];
+    std::ptrdiff_t _strides[maxViewDims];
+    Manager::Ptr _owner;
+};
+
+template<typename T>
+using ConstArrayView = ArrayView<const T>;
+
+namespace detail
+{
+    // Number of output dimensions produced by a list of view indices.
+    template<typename... Is>
+    struct count_view_dims : std::integral_constant<int, 0> {};
+    
+    template<typename I, typename... Is>
+    struct count_view_dims<I, Is...>
+        : std::integral_constant<int, (std::is_integral<I>::value ? 0 : 1) + count_view_dims<Is...>::value> {};
+    
+    // Resolves integers, slices and newaxis against a shape, writing the
+    // result into inline storage.
+    class ViewBuilder
+    {
+    public:
+        ViewBuilder(int ndims, const size_t* shape, const std::ptrdiff_t* strides, std::ptrdiff_t offset)
+            : _ndims(ndims), _shape(shape), _strides(strides), _in(0), _out(0), _offset(offset)
+        {}
+        
+        void apply(std::ptrdiff_t index)
+        {
+            checkInput();
+            if(index < 0)
+                index += _shape[_in];
+            
+            assert((index >= 0 && index < std::ptrdiff_t(_shape[_in])) && "index out of range");
+            
+            _offset += index * _strides[_in];
+            ++_in;
+        }
+        
+        void apply(const Slice& slice)
+        {
+            checkInput();
+            checkOutput();
+            
+            const std::ptrdiff_t start = slice.start(_shape[_in]);
+            const std::ptrdiff_t end = slice.end(_shape[_in]);
+            const int step = slice.step();
+            
+            const std::ptrdiff_t length = step > 0 ? end - start : start - end;
+            const std::ptrdiff_t n = length > 0 ? ceil_div<std::ptrdiff_t>(length, std::abs(step)) : 0;
+            
+            _outShape[_out] = n;
+            _outStrides[_out] = step * _strides[_in];
+            _offset += start * _strides[_in];
+            ++_in;
+            ++_out;
+        }
+        
+        void apply(const NewAxis&)
+        {
+            checkOutput();
+            _outShape[_out] = 1;
+            _outStrides[_out] = 0;
+            ++_out;
+        }
+        
+        void finish()
+        {
+            for(; _in < _ndims; ++_in, ++_out)
+            {
+                checkOutput();
+                _outShape[_out] = _shape[_in];
+                _outStrides[_out] = _strides[_in];
+            }
+        }
+        
+        int ndims() const {return _out;}
+        const size_t* shape() const {return _outShape;}
+        const std::ptrdiff_t* strides() const {return _outStrides;}
+        std::ptrdiff_t offset() const {return _offset;}
+        
+    private:
+        void checkInput() const
+        {
+            if(_in >= _ndims)
+                throw std::invalid_argument("the index has more elements than array dimensions");
+        }
+        
+        void checkOutput() const
+        {
+            if(_out >= maxViewDims)
+                throw std::invalid_argument("too many dimensions for an ArrayView");
+        }
+        
+        int _ndims;
+        const size_t* _shape;
+        const std::ptrdiff_t* _strides;
+        int _in;
+        int _out;
+        std::ptrdiff_t _offset;
+        size_t _outShape[maxViewDims];
+        std::ptrdiff_t _outStrides[maxViewDims];
+    };
+}
+
+template<typename DT, typename Derived>
+template<typename... Is>
+ArrayView<DT> ArrayBase<DT, Derived>::view(const Is&... is) const
+{
+    static_assert(detail::count_view_dims<Is...>::value <= maxViewDims,
+        "too many dimensions for an ArrayView");
+    
+    detail::ViewBuilder builder(ndims(), shape().data(), strides().data(), offset());
+    int expand[] = {0, (builder.apply(is), 0)...};
+    (void)expand;
+    builder.finish();
+    
+    return ArrayView<DT>(reinterpret_cast<DT*>(_data + builder.offset()),
+        builder.ndims(), builder.shape(), builder.strides());
+}
+
+template<typename DT, typename Derived>
+template<typename... Is>
+typename std::enable_if<!detail::all_integral<Is...>::value, ArrayView<DT> >::type
+ArrayBase<DT, Derived>::operator()(const Is&... is) const
+{
+    return ArrayView<DT>(view(is...), manager());
+}
+
+template<typename T, typename Derived>
+ArrayView<const T> view(const ArrayBase<T, Derived>& array)
+{
+    return ArrayView<const T>(array);
+}
+
+template<typename T, typename Alloc>
+ArrayView<const T> view(const std::vector<T, Alloc>& vec)
+{
+    return ArrayView<const T>(vec);
+}
+
+}
+
+#endif
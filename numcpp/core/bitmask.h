@@ -0,0 +1,465 @@
+
+#ifndef NUMCPP_BITMASK_H
+#define NUMCPP_BITMASK_H
+
+#include <cstdint>
+
+#include "parallel.h"
+#include "mask.h"
+
+namespace numcpp
+{
+
+namespace detail
+{
+    constexpr size_t wordBits = 64;
+
+    inline int popcount(std::uint64_t word)
+    {
+        #if defined(__GNUC__)
+        return __builtin_popcountll(word);
+        #else
+        int count = 0;
+        for(; word; word &= word - 1)
+            ++count;
+        return count;
+        #endif
+    }
+
+    inline int lowestBit(std::uint64_t word)
+    {
+        #if defined(__GNUC__)
+        return __builtin_ctzll(word);
+        #else
+        int bit = 0;
+        for(; !(word & 1); word >>= 1)
+            ++bit;
+        return bit;
+        #endif
+    }
+
+    // Word with the first n bits set.
+    inline std::uint64_t lowBits(size_t n)
+    {
+        return n >= wordBits ? ~std::uint64_t(0) : (std::uint64_t(1) << n) - 1;
+    }
+}
+
+/// Boolean array stored as one bit per element.
+///
+/// Element i (in C order) is bit i % 64 of word i / 64; the bits past the
+/// last element are always zero. Like Array, copies share the same words.
+class BitMask
+{
+public:
+    BitMask() : _shape({0}), _numElements(0), _words(empty<std::uint64_t>({0})) {}
+
+    /// All-false mask.
+    explicit BitMask(const Shape& shape)
+        : _shape(shape), _numElements(prod(shape)),
+        _words(zeros<std::uint64_t>({ceil_div(_numElements, detail::wordBits)}))
+    {}
+
+    /// Pack a byte mask.
+    explicit BitMask(const Array<bool>& mask);
+
+    const Shape& shape() const {return _shape;}
+    int ndims() const {return _shape.size();}
+    size_t numElements() const {return _numElements;}
+    size_t numWords() const {return _words.numElements();}
+
+    std::uint64_t* words() const {return _words.cont_begin();}
+
+    bool test(size_t i) const
+    {
+        return (words()[i / detail::wordBits] >> (i % detail::wordBits)) & 1;
+    }
+
+    void set(size_t i, bool value)
+    {
+        std::uint64_t& word = words()[i / detail::wordBits];
+        const std::uint64_t bit = std::uint64_t(1) << (i % detail::wordBits);
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    /// Byte mask with the same values.
+    Array<bool> unpack() const;
+
+private:
+    Shape _shape;
+    size_t _numElements;
+    Array<std::uint64_t> _words;
+};
+
+namespace detail
+{
+    // Call f(w, begin, end) for every word w with the range of elements it
+    // covers, split across the thread pool.
+    template<typename Function>
+    void for_each_word(size_t numElements, Function&& f)
+    {
+        const size_t numWords = ceil_div(numElements, wordBits);
+        parallel_for(0, numWords, [&](size_t begin, size_t end)
+        {
+            for(size_t w = begin; w < end; ++w)
+                f(w, w * wordBits, std::min(numElements, (w + 1) * wordBits));
+        }, parallelThreshold / wordBits);
+    }
+
+    // Pack pred(i) for the elements of every word. The inner loop has a
+    // fixed trip count and no branches, so it vectorizes.
+    template<typename Predicate>
+    void pack_bits(std::uint64_t* words, size_t numElements, Predicate&& pred)
+    {
+        for_each_word(numElements, [&](size_t w, size_t begin, size_t end)
+        {
+            std::uint64_t word = 0;
+            for(size_t i = begin; i < end; ++i)
+                word |= std::uint64_t(bool(pred(i))) << (i - begin);
+            words[w] = word;
+        });
+    }
+
+    // Number of set bits before every chunk of words, as in chunkOffsets.
+    inline std::vector<size_t> wordChunkOffsets(const std::uint64_t* words, size_t numWords)
+    {
+        const size_t chunkSize = maskChunkSize(numWords);
+        std::vector<size_t> offsets(numWords == 0 ? 1 : ceil_div(numWords, chunkSize) + 1, 0);
+
+        for_each_chunk(numWords, [&](size_t c, size_t begin, size_t end)
+        {
+            size_t count = 0;
+            for(size_t w = begin; w < end; ++w)
+                count += popcount(words[w]);
+            offsets[c+1] = count;
+        });
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        return offsets;
+    }
+
+    // Copy the elements selected by the words to out, skipping empty words
+    // and copying full ones as a block.
+    template<typename T>
+    T* compact_bits(T* out, const T* in, const std::uint64_t* words, size_t numWords)
+    {
+        for(size_t w = 0; w < numWords; ++w, in += wordBits)
+        {
+            std::uint64_t word = words[w];
+            if(word == ~std::uint64_t(0))
+            {
+                out = std::copy(in, in + wordBits, out);
+                continue;
+            }
+
+            for(; word; word &= word - 1)
+                *out++ = in[lowestBit(word)];
+        }
+        return out;
+    }
+
+    template<typename T>
+    const T* expand_bits(T* out, const T* in, const std::uint64_t* words, size_t numWords)
+    {
+        for(size_t w = 0; w < numWords; ++w, out += wordBits)
+            for(std::uint64_t word = words[w]; word; word &= word - 1)
+                out[lowestBit(word)] = *in++;
+        return in;
+    }
+
+    inline void checkMask(const Shape& shape, const BitMask& mask)
+    {
+        if(mask.shape() != shape)
+            throw std::invalid_argument("the mask must have the same shape as the array");
+    }
+
+    template<typename T>
+    Array<T> contiguous(const Array<T>& arr)
+    {
+        return arr.isContiguous() ? arr : copy(arr);
+    }
+}
+
+inline BitMask::BitMask(const Array<bool>& mask)
+    : BitMask(mask.shape())
+{
+    Array<bool> m = detail::contiguous(mask);
+    const bool* pm = m.cont_begin();
+    detail::pack_bits(words(), _numElements, [pm](size_t i){return pm[i];});
+}
+
+inline Array<bool> BitMask::unpack() const
+{
+    Array<bool> res = empty<bool>(_shape);
+    bool* out = res.cont_begin();
+    const std::uint64_t* pw = words();
+    detail::for_each_word(_numElements, [&](size_t w, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+            out[i] = (pw[w] >> (i - begin)) & 1;
+    });
+    return res;
+}
+
+namespace detail
+{
+    template<typename Predicate, typename... T, int... Is>
+    void pack_map(std::uint64_t* words, size_t numElements, Predicate& pred,
+        const std::tuple<Array<T>...>& arrays, seq<Is...>)
+    {
+        auto p = std::make_tuple(static_cast<const T*>(std::get<Is>(arrays).cont_begin())...);
+        pack_bits(words, numElements, [&](size_t i){return pred(std::get<Is>(p)[i]...);});
+    }
+}
+
+/// Bit mask of pred(a, b, ...) evaluated elementwise on arrays of the same
+/// shape, without building an intermediate byte mask.
+template<typename Predicate, typename... T>
+BitMask bitmask_map(Predicate&& pred, const Array<T>&... arr)
+{
+    const Shape* shapes[] = {&arr.shape()...};
+    for(auto shape : shapes)
+        if(*shape != *shapes[0])
+            throw std::invalid_argument("bitmask_map: all the arrays must have the same shape");
+
+    BitMask res(*shapes[0]);
+    const std::tuple<Array<T>...> arrays(detail::contiguous(arr)...);
+    detail::pack_map(res.words(), res.numElements(), pred, arrays, detail::gen_seq<sizeof...(T)>());
+    return res;
+}
+
+// Comparisons producing bit masks: less_mask(a, b) is the packed a < b.
+// The second argument may also be a single value.
+#define DEFINE_MASK_COMPARISON(name, op) \
+template<typename T> \
+BitMask name(const Array<T>& a, const Array<T>& b) \
+{ \
+    return bitmask_map([](const T& x, const T& y){return x op y;}, a, b); \
+} \
+ \
+template<typename T> \
+BitMask name(const Array<T>& a, const T& value) \
+{ \
+    return bitmask_map([&value](const T& x){return x op value;}, a); \
+}
+
+DEFINE_MASK_COMPARISON(less_mask, <)
+DEFINE_MASK_COMPARISON(less_equal_mask, <=)
+DEFINE_MASK_COMPARISON(greater_mask, >)
+DEFINE_MASK_COMPARISON(greater_equal_mask, >=)
+DEFINE_MASK_COMPARISON(equal_mask, ==)
+DEFINE_MASK_COMPARISON(not_equal_mask, !=)
+
+#undef DEFINE_MASK_COMPARISON
+
+inline size_t count_nonzero(const BitMask& mask)
+{
+    const std::uint64_t* words = mask.words();
+    return detail::wordChunkOffsets(words, mask.numWords()).back();
+}
+
+/// Whether any element of the mask is true.
+inline bool any(const BitMask& mask)
+{
+    const std::uint64_t* words = mask.words();
+    return std::any_of(words, words + mask.numWords(), [](std::uint64_t w){return w != 0;});
+}
+
+/// Whether all the elements of the mask are true.
+inline bool all(const BitMask& mask)
+{
+    return count_nonzero(mask) == mask.numElements();
+}
+
+namespace detail
+{
+    template<typename Function>
+    BitMask word_map(const BitMask& a, const BitMask& b, Function f)
+    {
+        if(a.shape() != b.shape())
+            throw std::invalid_argument("bit masks must have the same shape");
+
+        BitMask res(a.shape());
+        const std::uint64_t* pa = a.words();
+        const std::uint64_t* pb = b.words();
+        std::uint64_t* out = res.words();
+        for(size_t w = 0; w < res.numWords(); ++w)
+            out[w] = f(pa[w], pb[w]);
+        return res;
+    }
+}
+
+inline BitMask operator&(const BitMask& a, const BitMask& b)
+{
+    return detail::word_map(a, b, [](std::uint64_t x, std::uint64_t y){return x & y;});
+}
+
+inline BitMask operator|(const BitMask& a, const BitMask& b)
+{
+    return detail::word_map(a, b, [](std::uint64_t x, std::uint64_t y){return x | y;});
+}
+
+inline BitMask operator^(const BitMask& a, const BitMask& b)
+{
+    return detail::word_map(a, b, [](std::uint64_t x, std::uint64_t y){return x ^ y;});
+}
+
+inline BitMask operator~(const BitMask& a)
+{
+    BitMask res = detail::word_map(a, a, [](std::uint64_t x, std::uint64_t){return ~x;});
+    // Keep the bits past the last element cleared.
+    if(res.numWords() > 0)
+        res.words()[res.numWords()-1] &= detail::lowBits(res.numElements() - (res.numWords() - 1) * detail::wordBits);
+    return res;
+}
+
+/// Elementwise selection with a bit mask: a where mask is true, b elsewhere.
+template<typename T>
+Array<T> where(const BitMask& mask, const Array<T>& a, const Array<T>& b)
+{
+    detail::checkMask(a.shape(), mask);
+    detail::checkMask(b.shape(), mask);
+
+    Array<T> ca = detail::contiguous(a);
+    Array<T> cb = detail::contiguous(b);
+    const T* pa = ca.cont_begin();
+    const T* pb = cb.cont_begin();
+    const std::uint64_t* words = mask.words();
+
+    Array<T> res = empty<T>(a.shape());
+    T* out = res.cont_begin();
+    detail::for_each_word(mask.numElements(), [&](size_t w, size_t begin, size_t end)
+    {
+        const std::uint64_t word = words[w];
+        if(word == 0)
+            std::copy(pb + begin, pb + end, out + begin);
+        else if(word == detail::lowBits(end - begin))
+            std::copy(pa + begin, pa + end, out + begin);
+        else
+            for(size_t i = begin; i < end; ++i)
+                out[i] = (word >> (i - begin)) & 1 ? pa[i] : pb[i];
+    });
+
+    return res;
+}
+
+/// 1-D array with the elements of arr where mask is true, in C order.
+template<typename T>
+Array<T> compress(const Array<T>& arr, const BitMask& mask)
+{
+    detail::checkMask(arr.shape(), mask);
+
+    Array<T> src = detail::contiguous(arr);
+    const std::uint64_t* words = mask.words();
+    const size_t numWords = mask.numWords();
+    const std::vector<size_t> offsets = detail::wordChunkOffsets(words, numWords);
+
+    Array<T> res = empty<T>({offsets.back()});
+    const T* in = src.cont_begin();
+    T* out = res.cont_begin();
+
+    // Full words are copied as blocks, so the last one, which may be
+    // partial, is done separately.
+    detail::for_each_chunk(numWords, [&](size_t c, size_t begin, size_t end)
+    {
+        const size_t fullEnd = std::min(end, src.numElements() / detail::wordBits);
+        T* pout = out + offsets[c];
+        if(begin < fullEnd)
+            pout = detail::compact_bits(pout, in + begin * detail::wordBits, words + begin, fullEnd - begin);
+        for(size_t w = std::max(begin, fullEnd); w < end; ++w)
+            for(std::uint64_t word = words[w]; word; word &= word - 1)
+                *pout++ = in[w * detail::wordBits + detail::lowestBit(word)];
+    });
+
+    return res;
+}
+
+template<typename DT, typename Derived>
+Array<DT> ArrayBase<DT, Derived>::operator[](const BitMask& mask) const
+{
+    return compress(Array<DT>(_core), mask);
+}
+
+/// Target of a masked assignment with a bit mask, see ArrayBase::masked().
+template<typename T>
+class BitMaskedArray
+{
+public:
+    BitMaskedArray(const Array<T>& array, const BitMask& mask)
+        : _array(array), _mask(mask)
+    {
+        detail::checkMask(array.shape(), mask);
+    }
+
+    /// Set every selected element to value.
+    BitMaskedArray& operator=(const T& value)
+    {
+        if(!_array.isContiguous())
+        {
+            Array<T> arr(_array);
+            size_t i = 0;
+            for(auto& x : arr)
+                if(_mask.test(i++))
+                    x = value;
+            return *this;
+        }
+
+        T* out = _array.cont_begin();
+        const std::uint64_t* words = _mask.words();
+        detail::for_each_word(_mask.numElements(), [&](size_t w, size_t begin, size_t end)
+        {
+            const std::uint64_t word = words[w];
+            if(word == detail::lowBits(end - begin))
+                std::fill(out + begin, out + end, value);
+            else
+                for(std::uint64_t bits = word; bits; bits &= bits - 1)
+                    out[begin + detail::lowestBit(bits)] = value;
+        });
+        return *this;
+    }
+
+    /// Scatter the 1-D array values, in C order, to the selected elements.
+    BitMaskedArray& operator=(const Array<T>& values)
+    {
+        const std::uint64_t* words = _mask.words();
+        const size_t numWords = _mask.numWords();
+        const std::vector<size_t> offsets = detail::wordChunkOffsets(words, numWords);
+
+        if(values.ndims() != 1 || size_t(values.numElements()) != offsets.back())
+            throw std::invalid_argument("masked assignment needs as many values as true elements in the mask");
+
+        Array<T> src = detail::contiguous(values);
+        const T* in = src.cont_begin();
+
+        if(!_array.isContiguous())
+        {
+            Array<T> arr(_array);
+            size_t i = 0;
+            for(auto& x : arr)
+                if(_mask.test(i++))
+                    x = *in++;
+            return *this;
+        }
+
+        T* out = _array.cont_begin();
+        detail::for_each_chunk(numWords, [&](size_t c, size_t begin, size_t end)
+        {
+            detail::expand_bits(out + begin * detail::wordBits, in + offsets[c], words + begin, end - begin);
+        });
+        return *this;
+    }
+
+private:
+    Array<T> _array;
+    BitMask _mask;
+};
+
+template<typename DT, typename Derived>
+BitMaskedArray<DT> ArrayBase<DT, Derived>::masked(const BitMask& mask) const
+{
+    return BitMaskedArray<DT>(Array<DT>(_core), mask);
+}
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+
+#ifndef NUMCPP_CAST_H
+#define NUMCPP_CAST_H
+
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <cmath>
+
+#include "parallel.h"
+#include "half.h"
+
+namespace numcpp
+{
+
+/// How cast converts values that do not fit the output type.
+///
+/// Truncate is a plain static_cast. Round rounds floating point values to
+/// the nearest integer (ties to even) before converting them to an integer
+/// type. Saturate clamps out-of-range values to the limits of an integer
+/// output type and maps NaN to zero. RoundSaturate does both.
+enum class CastMode {Truncate, Round, Saturate, RoundSaturate};
+
+namespace detail
+{
+    template<typename T>
+    struct is_complex : std::false_type {};
+
+    template<typename T>
+    struct is_complex<std::complex<T> > : std::true_type {};
+
+    template<bool B>
+    using bool_constant = std::integral_constant<bool, B>;
+
+    // Half floats convert through float.
+    template<typename T>
+    struct work_type {typedef T type;};
+
+    template<typename F>
+    struct work_type<HalfFloat<F> > {typedef float type;};
+
+    // Rounding only makes a difference from floating point to integer.
+    template<typename Tin>
+    Tin round_value(Tin x, std::true_type)
+    {
+        return std::nearbyint(x);
+    }
+
+    template<typename Tin>
+    Tin round_value(Tin x, std::false_type)
+    {
+        return x;
+    }
+
+    // Saturation from floating point to integer.
+    template<typename Tout, typename Tin>
+    Tout saturate_value(Tin x, std::true_type, std::false_type)
+    {
+        typedef std::numeric_limits<Tout> limits;
+        if(x != x)
+            return Tout(0);
+        if(x <= static_cast<Tin>(limits::min()))
+            return limits::min();
+        if(x >= static_cast<Tin>(limits::max()))
+            return limits::max();
+        return static_cast<Tout>(x);
+    }
+
+    // Saturation between integer types. The comparisons are done in the
+    // widest type of the right signedness.
+    template<typename Tout, typename Tin>
+    Tout saturate_value(Tin x, std::false_type, std::true_type)
+    {
+        typedef std::numeric_limits<Tout> limits;
+        if(std::is_signed<Tin>::value && x < Tin(0))
+        {
+            if(static_cast<std::intmax_t>(x) < static_cast<std::intmax_t>(limits::min()))
+                return limits::min();
+        }
+        else if(static_cast<std::uintmax_t>(x) > static_cast<std::uintmax_t>(limits::max()))
+            return limits::max();
+        return static_cast<Tout>(x);
+    }
+
+    // Any other pair of types: saturation does not apply.
+    template<typename Tout, typename Tin, typename FloatIn, typename IntIn>
+    Tout saturate_value(Tin x, FloatIn, IntIn)
+    {
+        return static_cast<Tout>(x);
+    }
+
+    template<typename Tout, typename Tin, CastMode mode>
+    struct Converter
+    {
+        static constexpr bool toInteger = std::is_integral<Tout>::value && !std::is_same<Tout, bool>::value;
+        typedef typename work_type<Tin>::type Work;
+        static constexpr bool round = (mode == CastMode::Round || mode == CastMode::RoundSaturate)
+            && toInteger && std::is_floating_point<Work>::value;
+        static constexpr bool saturate = (mode == CastMode::Saturate || mode == CastMode::RoundSaturate)
+            && toInteger;
+
+        static Tout apply(Tin x)
+        {
+            const Work y = round_value(static_cast<Work>(x), bool_constant<round>());
+            if(!saturate)
+                return static_cast<Tout>(y);
+            return saturate_value<Tout>(y, bool_constant<saturate && std::is_floating_point<Work>::value>(),
+                bool_constant<saturate && std::is_integral<Work>::value>());
+        }
+    };
+
+    // Conversion of n contiguous elements. The loop has no branches that
+    // depend on the data, so that the compiler can vectorize it.
+    template<CastMode mode, typename Tout, typename Tin>
+    void convert_n(Tout* out, const Tin* in, size_t n, std::false_type)
+    {
+        for(size_t i = 0; i < n; ++i)
+            out[i] = Converter<Tout, Tin, mode>::apply(in[i]);
+    }
+
+    // Real to complex: write the interleaved real and imaginary parts as
+    // plain values instead of constructing complex numbers one by one.
+    template<CastMode mode, typename Tout, typename Tin>
+    void convert_n(Tout* out, const Tin* in, size_t n, std::true_type)
+    {
+        typedef typename Tout::value_type U;
+        U* parts = reinterpret_cast<U*>(out);
+        for(size_t i = 0; i < n; ++i)
+        {
+            parts[2*i] = static_cast<U>(in[i]);
+            parts[2*i+1] = U(0);
+        }
+    }
+
+    template<CastMode mode, typename Tout, typename Tin>
+    void convert_n(Tout* out, const Tin* in, size_t n)
+    {
+        convert_n<mode>(out, in, n, bool_constant<is_complex<Tout>::value && !is_complex<Tin>::value>());
+    }
+
+    template<CastMode mode, typename F>
+    void convert_n(float* out, const HalfFloat<F>* in, size_t n)
+    {
+        widen(out, in, n);
+    }
+
+    template<CastMode mode, typename F>
+    void convert_n(HalfFloat<F>* out, const float* in, size_t n)
+    {
+        narrow(out, in, n);
+    }
+
+    template<CastMode mode, typename Tout, typename Tin>
+    void convert_strided(unsigned char* out, std::ptrdiff_t outStride,
+        const unsigned char* in, std::ptrdiff_t inStride, size_t n)
+    {
+        if(outStride == std::ptrdiff_t(sizeof(Tout)) && inStride == std::ptrdiff_t(sizeof(Tin)))
+        {
+            convert_n<mode>(reinterpret_cast<Tout*>(out), reinterpret_cast<const Tin*>(in), n);
+            return;
+        }
+
+        for(size_t i = 0; i < n; ++i, out += outStride, in += inStride)
+            *reinterpret_cast<Tout*>(out) = Converter<Tout, Tin, mode>::apply(*reinterpret_cast<const Tin*>(in));
+    }
+
+    template<CastMode mode, typename Tout, typename Tin>
+    void cast_into(const Array<Tout>& out, const Array<Tin>& in)
+    {
+        // Same dense layout: a single flat loop, split across threads.
+        if((out.isContiguous() && in.isContiguous()) || (out.isFContiguous() && in.isFContiguous()))
+        {
+            Tout* pout = out.cont_begin();
+            const Tin* pin = in.cont_begin();
+            parallel_for(0, out.numElements(), [&](size_t begin, size_t end)
+            {
+                convert_n<mode>(pout + begin, pin + begin, end - begin);
+            }, parallelThreshold);
+            return;
+        }
+
+        const int ndims = out.ndims();
+        if(ndims > maxViewDims)
+        {
+            // Too many dimensions for the row loop: element by element.
+            auto it = in.begin();
+            for(Tout& v : out)
+            {
+                v = Converter<Tout, Tin, mode>::apply(*it);
+                ++it;
+            }
+            return;
+        }
+        
+        const std::ptrdiff_t outStride = ndims > 0 ? out.strides()[ndims-1] : 0;
+        const std::ptrdiff_t inStride = ndims > 0 ? in.strides()[ndims-1] : 0;
+        strided_for_each_row<2>(ndims, out.shape().data(),
+            {{firstByte(out), firstByte(in)}},
+            {{out.strides().data(), in.strides().data()}},
+            [outStride, inStride](const std::array<unsigned char*, 2>& p, size_t n)
+            {
+                convert_strided<mode, Tout, Tin>(p[0], outStride, p[1], inStride, n);
+            });
+    }
+}
+
+/// Convert the elements of in and store them in out, which must have the
+/// same shape. Nothing is allocated.
+template<typename Tout, typename Tin>
+void cast_into(const Array<Tout>& out, const Array<Tin>& in, CastMode mode=CastMode::Truncate)
+{
+    if(out.shape() != in.shape())
+        throw std::invalid_argument("cast_into: input and output must have the same shape");
+
+    switch(mode)
+    {
+    case CastMode::Truncate:
+        detail::cast_into<CastMode::Truncate>(out, in);
+        break;
+    case CastMode::Round:
+        detail::cast_into<CastMode::Round>(out, in);
+        break;
+    case CastMode::Saturate:
+        detail::cast_into<CastMode::Saturate>(out, in);
+        break;
+    case CastMode::RoundSaturate:
+        detail::cast_into<CastMode::RoundSaturate>(out, in);
+        break;
+    }
+}
+
+namespace detail
+{
+    template<typename Tout, typename Tin>
+    Array<Tout> cast(const Array<Tin>& in, CastMode mode, std::false_type)
+    {
+        Array<Tout> res = empty<Tout>(in.shape(), in.isFContiguous() && !in.isContiguous() ? Order::F : Order::C);
+        numcpp::cast_into(res, in, mode);
+        return res;
+    }
+
+    template<typename T>
+    Array<T> cast(const Array<T>& in, CastMode, std::true_type)
+    {
+        return in;
+    }
+}
+
+/// Array with the elements of in converted to Tout. Casting to the same type
+/// returns in itself, without copying.
+template<typename Tout, typename Tin>
+Array<Tout> cast(const Array<Tin>& in, CastMode mode=CastMode::Truncate)
+{
+    return detail::cast<Tout>(in, mode, std::is_same<Tout,Tin>());
+}
+
+template<typename Tout, typename Tin>
+Array<Tout> cast(const ArrayView<Tin>& in, CastMode mode=CastMode::Truncate)
+{
+    switch(mode)
+    {
+    case CastMode::Round:
+        return array_map(detail::Converter<Tout, Tin, CastMode::Round>::apply, in);
+    case CastMode::Saturate:
+        return array_map(detail::Converter<Tout, Tin, CastMode::Saturate>::apply, in);
+    case CastMode::RoundSaturate:
+        return array_map(detail::Converter<Tout, Tin, CastMode::RoundSaturate>::apply, in);
+    default:
+        return array_map(detail::Converter<Tout, Tin, CastMode::Truncate>::apply, in);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+
+#ifndef NUMCPP_COWARRAY_H
+#define NUMCPP_COWARRAY_H
+
+#include <atomic>
+
+#include "array.h"
+#include "initialization.h"
+
+namespace numcpp
+{
+
+namespace detail
+{
+    struct CowCounters
+    {
+        std::atomic<size_t> shared;
+        std::atomic<size_t> detached;
+
+        CowCounters()
+            : shared(0), detached(0)
+        {}
+    };
+
+    inline CowCounters& cowCounters()
+    {
+        static CowCounters counters;
+        return counters;
+    }
+}
+
+// Number of CowArray copies that shared their buffer instead of copying it.
+inline size_t cowShared() {return detail::cowCounters().shared;}
+
+// Number of shared CowArrays that had to be materialized on a mutating access.
+inline size_t cowDetached() {return detail::cowCounters().detached;}
+
+// Number of deep copies that were never needed. Buffers shared outside of
+// CowArray (through array()) can be detached without a counted share, so the
+// difference is clamped at zero.
+inline size_t cowCopiesAvoided()
+{
+    const size_t shared = cowShared();
+    const size_t detached = cowDetached();
+    return shared > detached ? shared - detached : 0;
+}
+
+inline void resetCowCounters()
+{
+    detail::cowCounters().shared = 0;
+    detail::cowCounters().detached = 0;
+}
+
+/// Array with copy-on-write semantics.
+///
+/// Copies share the buffer of the original. Any mutating access (non-const
+/// operator(), deep() or writable()) detaches the array first whenever the
+/// buffer is also referenced from somewhere else. Reads through a const
+/// CowArray never copy; reads through a non-const one do, so loops that only
+/// read should go through a const reference or array().
+///
+/// Detaching only touches this object, so distinct CowArrays sharing a buffer
+/// can be detached concurrently from different threads. A single CowArray is
+/// not meant to be mutated from several threads at once.
+template<typename T>
+class CowArray
+{
+public:
+    typedef T value_type;
+
+    CowArray()
+    {}
+
+    /// Shares the buffer of array, which counts as a share when array is
+    /// still referenced elsewhere.
+    CowArray(const Array<T>& array)
+        : _array(array)
+    {
+        if(isShared())
+            ++detail::cowCounters().shared;
+    }
+
+    CowArray(Array<T>&& array)
+        : _array(std::move(array))
+    {}
+
+    CowArray(const CowArray& rhs)
+        : _array(rhs._array)
+    {
+        if(!_array.isNull())
+            ++detail::cowCounters().shared;
+    }
+
+    // Moves hand the buffer over without sharing it. They are noexcept so
+    // that std::vector moves its CowArrays when it grows.
+    CowArray(CowArray&& rhs) noexcept
+        : _array(rhs._array)
+    {
+        rhs._array = Array<T>();
+    }
+
+    CowArray& operator=(const CowArray& rhs)
+    {
+        if(this == &rhs)
+            return *this;
+
+        _array = rhs._array;
+        if(!_array.isNull())
+            ++detail::cowCounters().shared;
+
+        return *this;
+    }
+
+    CowArray& operator=(CowArray&& rhs) noexcept
+    {
+        if(this == &rhs)
+            return *this;
+
+        _array = rhs._array;
+        rhs._array = Array<T>();
+        return *this;
+    }
+
+    template<typename... Is>
+    const T& operator()(Is... is) const
+    {
+        return _array(is...);
+    }
+
+    /// Mutable element access: detaches even when it is only used to read.
+    template<typename... Is>
+    T& operator()(Is... is)
+    {
+        detach();
+        return _array(is...);
+    }
+
+    ArrayRef<T> deep()
+    {
+        detach();
+        return _array.deep();
+    }
+
+    /// Read-only access to the underlying array. Writing through the returned
+    /// array bypasses the copy-on-write mechanism.
+    const Array<T>& array() const {return _array;}
+
+    /// Array that can be safely modified.
+    Array<T>& writable()
+    {
+        detach();
+        return _array;
+    }
+
+    void detach()
+    {
+        if(!isShared())
+            return;
+
+        _array = copy(_array);
+        ++detail::cowCounters().detached;
+    }
+
+    bool isShared() const {return _array.useCount() > 1;}
+
+    int numElements() const {return _array.numElements();}
+    const Shape& shape() const {return _array.shape();}
+    const Strides& strides() const {return _array.strides();}
+    int ndims() const {return _array.ndims();}
+    bool isNull() const {return _array.isNull();}
+
+private:
+    Array<T> _array;
+};
+
+template<typename T>
+CowArray<T> cow(const Array<T>& array)
+{
+    return CowArray<T>(array);
+}
+
+template<typename T>
+CowArray<T> cow(Array<T>&& array)
+{
+    return CowArray<T>(std::move(array));
+}
+
+}
+
+#endif
@@ -18,6 +18,59 @@ namespace detail
     }
 }
 
+namespace detail
+{
+    template<typename TR, typename Function, typename... T>
+    void flat_map(Function& f, size_t n, TR* out, const T*... in)
+    {
+        for(size_t i = 0; i < n; ++i)
+            out[i] = f(in[i]...);
+    }
+    
+    template<typename TR, typename... T, typename Function, size_t N, int... Is>
+    void row_map(Function& f, const std::array<unsigned char*, N>& p, size_t n, seq<Is...>)
+    {
+        flat_map(f, n, reinterpret_cast<TR*>(p[N-1]), reinterpret_cast<const T*>(p[Is])...);
+    }
+    
+    template<typename... T>
+    bool commonRowLayout(const Array<T>&... arr)
+    {
+        const Shape* shapes[] = {&arr.shape()...};
+        const bool unit[] = {hasUnitInnerStride(arr)...};
+        
+        for(size_t i = 0; i < sizeof...(T); ++i)
+            if(!unit[i] || *shapes[i] != *shapes[0])
+                return false;
+        
+        return true;
+    }
+    
+    // Order in which all the arrays are dense with the same shape, if any.
+    template<typename... T>
+    bool commonDenseOrder(Order& order, const Array<T>&... arr)
+    {
+        const Shape* shapes[] = {&arr.shape()...};
+        const bool cont[] = {arr.isContiguous()...};
+        const bool fcont[] = {arr.isFContiguous()...};
+        
+        bool allC = true, allF = true;
+        for(size_t i = 0; i < sizeof...(T); ++i)
+        {
+            if(*shapes[i] != *shapes[0])
+                return false;
+            allC = allC && cont[i];
+            allF = allF && fcont[i];
+        }
+        
+        if(!allC && !allF)
+            return false;
+        
+        order = allC ? Order::C : Order::F;
+        return true;
+    }
+}
+
 // Maps
 template<typename Function, typename... T>
 auto array_map(Function&& f, const Array<T>&... arr)
@@ -26,6 +79,33 @@ auto array_map(Function&& f, const Array<T>&... arr)
     typedef decltype(f(T()...)) TR;
     constexpr int V = sizeof...(T);
     
+    // Elementwise maps do not depend on the element order: when all the
+    // inputs share a dense layout, walk the memory linearly and give the
+    // result that same layout.
+    Order order;
+    if(detail::commonDenseOrder(order, arr...))
+    {
+        const Shape& shape = std::get<0>(std::forward_as_tuple(arr...)).shape();
+        auto res = empty<TR>(shape, order);
+        detail::flat_map(f, res.numElements(), res.data(), arr.cont_begin()...);
+        return res;
+    }
+    
+    // Padded or sliced arrays with unit-strided rows: flat loop on each row.
+    if(detail::commonRowLayout(arr...))
+    {
+        const Shape& shape = std::get<0>(std::forward_as_tuple(arr...)).shape();
+        auto res = empty<TR>(shape);
+        detail::strided_for_each_row<V+1>(res.ndims(), shape.data(),
+            {{detail::firstByte(arr)..., detail::firstByte(res)}},
+            {{arr.strides().data()..., res.strides().data()}},
+            [&f](const std::array<unsigned char*, V+1>& p, size_t n)
+            {
+                detail::row_map<TR, T...>(f, p, n, detail::gen_seq<V>());
+            });
+        return res;
+    }
+    
     auto all_ndims = std::vector<int>({arr.ndims()...});
     int max_ndims = *std::max_element(all_ndims.begin(), all_ndims.end());
     
@@ -69,6 +149,69 @@ auto array_map(Function&& f, const Array<T>&... arr)
     }
 }
 
+namespace detail
+{
+    template<typename TR, typename... T, typename Function, size_t N, int... Is>
+    void call_on_pointers(Function& f, const std::array<unsigned char*, N>& p, seq<Is...>)
+    {
+        *reinterpret_cast<TR*>(p[N-1]) = f(*reinterpret_cast<T*>(p[Is])...);
+    }
+}
+
+// Maps on views. The views are broadcasted together without building any
+// intermediate array; only the result is allocated.
+template<typename Function, typename... T>
+auto array_map(Function&& f, const ArrayView<T>&... views)
+    -> Array<decltype(f(T()...))>
+{
+    typedef decltype(f(T()...)) TR;
+    constexpr int V = sizeof...(T);
+    
+    const int ndims = std::max({views.ndims()...});
+    const int all_ndims[] = {views.ndims()...};
+    const size_t* all_shapes[] = {views.shapeData()...};
+    const std::ptrdiff_t* all_strides[] = {views.stridesData()...};
+    
+    size_t shape[maxViewDims];
+    std::ptrdiff_t strides[V+1][maxViewDims];
+    for(int i = 0; i < ndims; ++i)
+    {
+        shape[i] = 1;
+        for(int k = 0; k < V; ++k)
+        {
+            const int axis = i - (ndims - all_ndims[k]);
+            const size_t s = axis >= 0 ? all_shapes[k][axis] : 1;
+            if(s == 1 || s == shape[i])
+                continue;
+            if(shape[i] != 1)
+                throw std::invalid_argument("views in array_map cannot be broadcasted together");
+            shape[i] = s;
+        }
+        
+        for(int k = 0; k < V; ++k)
+        {
+            const int axis = i - (ndims - all_ndims[k]);
+            strides[k][i] = (axis < 0 || all_shapes[k][axis] == 1) ? 0 : all_strides[k][axis];
+        }
+    }
+    
+    Array<TR> res = empty<TR>(Shape(shape, shape + ndims));
+    std::copy(res.strides().begin(), res.strides().end(), strides[V]);
+    
+    std::array<unsigned char*, V+1> ptrs = {{views.bytes()..., reinterpret_cast<unsigned char*>(res.data())}};
+    std::array<const std::ptrdiff_t*, V+1> strides_ptrs;
+    for(int k = 0; k <= V; ++k)
+        strides_ptrs[k] = strides[k];
+    
+    detail::strided_for_each<V+1>(ndims, shape, ptrs, strides_ptrs,
+        [&f](const std::array<unsigned char*, V+1>& p)
+        {
+            detail::call_on_pointers<TR, T...>(f, p, detail::gen_seq<V>());
+        });
+    
+    return res;
+}
+
 template<typename T1, typename T2>
 auto operator+(const Array<T1>& arr1, const Array<T2>& arr2)
     -> Array<decltype(T1() + T2())>
@@ -133,33 +276,18 @@ Array<bool> operator!=(const Array<T1>& arr1, const Array<T2>& arr2)
     return array_map([](const T1& a, const T2& b){return a!=b;}, arr1, arr2);
 }
 
-namespace detail
-{
-    template<typename Tout, typename Tin>
-    Array<Tout> cast(const Array<Tin>& in, std::false_type)
-    {
-        return array_map([](const Tin& a){return static_cast<Tout>(a);}, in);
-    }
-
-    template<typename T>
-    Array<T> cast(const Array<T>& in, std::true_type)
-    {
-        return in;
-    }
-}
-
-template<typename Tout, typename Tin>
-Array<Tout> cast(const Array<Tin>& in)
-{
-    return detail::cast<Tout>(in, std::is_same<Tout,Tin>());
-}
-
 #define VECTORIZE(vectorizedname, name) \
 template<typename... T> \
 auto vectorizedname(const Array<T>&... arr) \
     -> decltype(array_map(name, arr...)) \
 { \
     return array_map(name, arr...); \
+} \
+template<typename... T> \
+auto vectorizedname(const ArrayView<T>&... arr) \
+    -> decltype(array_map(name, arr...)) \
+{ \
+    return array_map(name, arr...); \
 }
 
 VECTORIZE(sin, ::sin)
@@ -209,6 +337,9 @@ VECTORIZE(isfinite, std::isfinite)
 template<typename T>
 T sum(const Array<T>& arr)
 {
+    if(arr.isDense())
+        return std::accumulate(arr.cont_begin(), arr.cont_end(), T(0));
+    
     return std::accumulate(arr.begin(), arr.end(), T(0));
 }
 
@@ -233,6 +364,193 @@ Array<T> sum(const Array<T>& arr, int axis)
     return res;
 }
 
+template<typename T>
+typename std::remove_const<T>::type sum(const ArrayView<T>& arr)
+{
+    typename std::remove_const<T>::type res(0);
+    arr.for_each([&res](const T& x){res += x;});
+    return res;
+}
+
+template<typename T>
+Array<typename std::remove_const<T>::type> sum(const ArrayView<T>& arr, int axis)
+{
+    typedef typename std::remove_const<T>::type TR;
+    
+    if(axis < 0)
+        axis = arr.ndims() + axis;
+    
+    assert(axis >= 0 && axis < arr.ndims());
+    
+    Shape newShape(arr.shapeData(), arr.shapeData() + arr.ndims());
+    newShape.erase(newShape.begin() + axis);
+    
+    auto res = zeros<TR>(newShape);
+    
+    // Accumulate with a zero stride along the reduced axis of the result.
+    std::ptrdiff_t res_strides[maxViewDims];
+    std::copy(res.strides().begin(), res.strides().begin() + axis, res_strides);
+    res_strides[axis] = 0;
+    std::copy(res.strides().begin() + axis, res.strides().end(), res_strides + axis + 1);
+    
+    detail::strided_for_each<2>(arr.ndims(), arr.shapeData(),
+        {{arr.bytes(), reinterpret_cast<unsigned char*>(res.data())}},
+        {{arr.stridesData(), res_strides}},
+        [](const std::array<unsigned char*, 2>& p)
+        {
+            *reinterpret_cast<TR*>(p[1]) += *reinterpret_cast<const T*>(p[0]);
+        });
+    
+    return res;
+}
+
+namespace detail
+{
+    // Byte offset, relative to the array offset, of the k-th 1-D lane along
+    // axis. Lanes are numbered in C order over the remaining axes.
+    inline std::ptrdiff_t laneOffset(size_t k, const Shape& shape, const Strides& strides, int axis)
+    {
+        std::ptrdiff_t offset = 0;
+        for(int i = int(shape.size()) - 1; i >= 0; --i)
+        {
+            if(i == axis)
+                continue;
+            
+            offset += std::ptrdiff_t(k % shape[i]) * strides[i];
+            k /= shape[i];
+        }
+        return offset;
+    }
+    
+    inline size_t numLanes(const Shape& shape, int axis)
+    {
+        size_t res = 1;
+        for(int i = 0; i < int(shape.size()); ++i)
+            if(i != axis)
+                res *= shape[i];
+        return res;
+    }
+    
+    // Lane array reused for every lane of a chunk; only its offset changes.
+    template<typename T>
+    Array<T> laneArray(const Array<T>& arr, int axis)
+    {
+        return Array<T>(ArrayCore(Shape{arr.shape()[axis]}, Strides{arr.strides()[axis]},
+            arr.manager(), arr.offset()));
+    }
+    
+    template<typename R>
+    struct along_axis_result
+    {
+        typedef Array<R> type;
+        typedef std::false_type returns_array;
+    };
+    
+    template<typename U>
+    struct along_axis_result<Array<U> >
+    {
+        typedef Array<U> type;
+        typedef std::true_type returns_array;
+    };
+    
+    template<typename Function, typename T>
+    auto apply_along_axis(Function& f, const Array<T>& arr, int axis, std::false_type)
+        -> Array<decltype(f(arr))>
+    {
+        typedef decltype(f(arr)) R;
+        
+        Shape newShape(arr.shape());
+        newShape.erase(newShape.begin() + axis);
+        auto res = empty<R>(newShape);
+        R* out = res.data();
+        
+        const size_t laneLength = std::max<size_t>(1, arr.shape()[axis]);
+        parallel_for(0, numLanes(arr.shape(), axis), [&](size_t begin, size_t end)
+        {
+            auto lane = laneArray(arr, axis);
+            for(size_t k = begin; k < end; ++k)
+            {
+                lane.core().setOffset(arr.offset() + laneOffset(k, arr.shape(), arr.strides(), axis));
+                out[k] = f(lane);
+            }
+        }, std::max<size_t>(1, parallelThreshold / laneLength));
+        
+        return res;
+    }
+    
+    template<typename Function, typename T>
+    auto apply_along_axis(Function& f, const Array<T>& arr, int axis, std::true_type)
+        -> decltype(f(arr))
+    {
+        typedef decltype(f(arr)) R;
+        
+        typedef typename R::value_type TR;
+        
+        // Without lanes f is never called; the axis keeps its length.
+        const size_t lanes = numLanes(arr.shape(), axis);
+        if(lanes == 0)
+            return empty<TR>(arr.shape());
+        
+        auto lane = laneArray(arr, axis);
+        R first = f(lane);
+        if(first.ndims() != 1)
+            throw std::invalid_argument("apply_along_axis: the function must return a 1-D array");
+        
+        Shape newShape(arr.shape());
+        newShape[axis] = first.shape()[0];
+        auto res = empty<TR>(newShape);
+        
+        auto resLane = laneArray(res, axis);
+        resLane.deep() = first;
+        
+        const size_t laneLength = std::max<size_t>(1, arr.shape()[axis]);
+        parallel_for(1, lanes, [&](size_t begin, size_t end)
+        {
+            auto lane = laneArray(arr, axis);
+            auto resLane = laneArray(res, axis);
+            for(size_t k = begin; k < end; ++k)
+            {
+                lane.core().setOffset(arr.offset() + laneOffset(k, arr.shape(), arr.strides(), axis));
+                resLane.core().setOffset(laneOffset(k, res.shape(), res.strides(), axis));
+                
+                R value = f(lane);
+                if(value.shape() != resLane.shape())
+                    throw std::invalid_argument("apply_along_axis: the function must always return arrays of the same length");
+                resLane.deep() = value;
+            }
+        }, std::max<size_t>(1, parallelThreshold / laneLength));
+        
+        return res;
+    }
+}
+
+/// Apply f to every 1-D lane of arr along axis.
+///
+/// f receives a const Array<T>& lane and returns either a scalar, in which
+/// case axis is removed from the result, or a 1-D array of fixed length that
+/// replaces axis. The lane array is reused between calls, so f must not keep
+/// references to it. Lanes are processed in parallel on the thread pool; f
+/// must be safe to call concurrently.
+template<typename Function, typename T>
+auto apply_along_axis(Function&& f, const Array<T>& arr, int axis)
+    -> typename detail::along_axis_result<decltype(f(arr))>::type
+{
+    if(axis < 0)
+        axis = arr.ndims() + axis;
+    
+    if(axis < 0 || axis >= arr.ndims())
+        throw std::invalid_argument("apply_along_axis: axis out of range");
+    
+    typedef typename detail::along_axis_result<decltype(f(arr))>::returns_array returns_array;
+    return detail::apply_along_axis(f, arr, axis, returns_array());
+}
+
+template<typename T>
+double mean(const ArrayView<T>& arr)
+{
+    return sum(arr) / static_cast<double>(arr.numElements());
+}
+
 template<typename T>
 double mean(const Array<T>& arr)
 {
@@ -0,0 +1,205 @@
+
+#ifndef NUMCPP_HALF_H
+#define NUMCPP_HALF_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace numcpp
+{
+
+namespace detail
+{
+    inline std::uint32_t floatBits(float x)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+
+    inline float bitsFloat(std::uint32_t bits)
+    {
+        float x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    // IEEE 754 binary16. Conversions round to nearest even and keep
+    // infinities, NaNs and subnormals. The F16C instructions are used when the
+    // compiler targets them.
+    struct Float16Format
+    {
+        static float toFloat(std::uint16_t h)
+        {
+            #if defined(__F16C__)
+            return _cvtsh_ss(h);
+            #else
+            const std::uint32_t shiftedExp = 0x7c00u << 13;
+            std::uint32_t bits = (h & 0x7fffu) << 13;
+            const std::uint32_t exp = bits & shiftedExp;
+            bits += (127 - 15) << 23;
+
+            if(exp == shiftedExp)
+                bits += (128 - 16) << 23;
+            else if(exp == 0)
+            {
+                // Subnormal: renormalize with a float subtraction.
+                bits += 1 << 23;
+                bits = floatBits(bitsFloat(bits) - bitsFloat(113u << 23));
+            }
+
+            return bitsFloat(bits | (std::uint32_t(h & 0x8000u) << 16));
+            #endif
+        }
+
+        static std::uint16_t fromFloat(float x)
+        {
+            #if defined(__F16C__)
+            return _cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT);
+            #else
+            std::uint32_t bits = floatBits(x);
+            const std::uint16_t sign = (bits >> 16) & 0x8000u;
+            bits &= 0x7fffffffu;
+
+            // Infinity and NaN, and finite values that overflow.
+            if(bits >= 0x47800000u)
+                return sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u);
+
+            // Subnormal results: let the float addition do the rounding.
+            if(bits < 0x38800000u)
+                return sign | std::uint16_t(floatBits(bitsFloat(bits) + 0.5f) - 0x3f000000u);
+
+            const std::uint32_t odd = (bits >> 13) & 1;
+            bits += 0xc8000fffu + odd;
+            return sign | std::uint16_t(bits >> 13);
+            #endif
+        }
+    };
+
+    // bfloat16: the upper half of a float. Conversions round to nearest
+    // even and keep NaNs quiet.
+    struct BFloat16Format
+    {
+        static float toFloat(std::uint16_t h)
+        {
+            return bitsFloat(std::uint32_t(h) << 16);
+        }
+
+        static std::uint16_t fromFloat(float x)
+        {
+            std::uint32_t bits = floatBits(x);
+            if((bits & 0x7fffffffu) > 0x7f800000u)
+                return std::uint16_t((bits >> 16) | 0x40u);
+
+            bits += 0x7fffu + ((bits >> 16) & 1);
+            return std::uint16_t(bits >> 16);
+        }
+    };
+}
+
+/// 16-bit floating point storage type.
+///
+/// Values are stored in 16 bits and widened to float for any arithmetic, so
+/// arrays of half floats halve the memory traffic of float arrays at the
+/// cost of precision. Construction from other types is explicit to keep
+/// mixed expressions unambiguous: they are evaluated in float.
+template<typename Format>
+class HalfFloat
+{
+public:
+    HalfFloat() : _bits(0) {}
+
+    template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    explicit HalfFloat(T x) : _bits(Format::fromFloat(static_cast<float>(x))) {}
+
+    operator float() const {return Format::toFloat(_bits);}
+
+    static HalfFloat fromBits(std::uint16_t bits)
+    {
+        HalfFloat h;
+        h._bits = bits;
+        return h;
+    }
+
+    std::uint16_t bits() const {return _bits;}
+
+    HalfFloat& operator+=(float x) {return *this = HalfFloat(float(*this) + x);}
+    HalfFloat& operator-=(float x) {return *this = HalfFloat(float(*this) - x);}
+    HalfFloat& operator*=(float x) {return *this = HalfFloat(float(*this) * x);}
+    HalfFloat& operator/=(float x) {return *this = HalfFloat(float(*this) / x);}
+
+private:
+    std::uint16_t _bits;
+};
+
+typedef HalfFloat<detail::Float16Format> float16;
+typedef HalfFloat<detail::BFloat16Format> bfloat16;
+
+template<typename F>
+HalfFloat<F> operator+(HalfFloat<F> a, HalfFloat<F> b) {return HalfFloat<F>(float(a) + float(b));}
+
+template<typename F>
+HalfFloat<F> operator-(HalfFloat<F> a, HalfFloat<F> b) {return HalfFloat<F>(float(a) - float(b));}
+
+template<typename F>
+HalfFloat<F> operator*(HalfFloat<F> a, HalfFloat<F> b) {return HalfFloat<F>(float(a) * float(b));}
+
+template<typename F>
+HalfFloat<F> operator/(HalfFloat<F> a, HalfFloat<F> b) {return HalfFloat<F>(float(a) / float(b));}
+
+template<typename F>
+HalfFloat<F> operator-(HalfFloat<F> a) {return HalfFloat<F>::fromBits(a.bits() ^ 0x8000u);}
+
+namespace detail
+{
+    // Bulk conversions used by the cast kernels.
+    template<typename F>
+    void widen(float* out, const HalfFloat<F>* in, size_t n)
+    {
+        for(size_t i = 0; i < n; ++i)
+            out[i] = float(in[i]);
+    }
+
+    template<typename F>
+    void narrow(HalfFloat<F>* out, const float* in, size_t n)
+    {
+        for(size_t i = 0; i < n; ++i)
+            out[i] = HalfFloat<F>(in[i]);
+    }
+
+    #if defined(__F16C__)
+    // Eight conversions per instruction.
+    inline void widen(float* out, const float16* in, size_t n)
+    {
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+        }
+        for(; i < n; ++i)
+            out[i] = float(in[i]);
+    }
+
+    inline void narrow(float16* out, const float* in, size_t n)
+    {
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+        }
+        for(; i < n; ++i)
+            out[i] = float16(in[i]);
+    }
+    #endif
+}
+
+}
+
+#endif
@@ -36,7 +36,7 @@ public:
     bool isSlice() const {return _tag==SLICE;}
     bool isNewAxis() const {return _tag==NEWAXIS;}
     int index() const {return _index;}
-    int index(int shape) const {return _index >= 0 ? _index : shape + _index;}
+    std::ptrdiff_t index(std::ptrdiff_t shape) const {return _index >= 0 ? _index : shape + _index;}
     const Slice& slice() const {return _slice;}
     
 protected:
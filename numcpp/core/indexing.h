@@ -0,0 +1,168 @@
+
+#ifndef NUMCPP_INDEXING_H
+#define NUMCPP_INDEXING_H
+
+#include "parallel.h"
+
+namespace numcpp
+{
+
+namespace detail
+{
+    inline void prefetch(const void* p)
+    {
+        #if defined(__GNUC__)
+        __builtin_prefetch(p);
+        #else
+        (void)p;
+        #endif
+    }
+
+    // How far ahead gathers prefetch their sources.
+    constexpr size_t prefetchDistance = 8;
+
+    // out[k] = element indices[k] of a strided 1-D source.
+    template<typename T>
+    void gather(T* out, const unsigned char* src, std::ptrdiff_t stride,
+        const size_t* indices, size_t n)
+    {
+        for(size_t k = 0; k < n; ++k)
+        {
+            if(k + prefetchDistance < n)
+                prefetch(src + indices[k + prefetchDistance] * stride);
+            out[k] = *reinterpret_cast<const T*>(src + indices[k] * stride);
+        }
+    }
+
+    // Contiguous blocks of blockSize elements: out block k = source block
+    // indices[k]. This is the row gather of a C-contiguous matrix.
+    template<typename T>
+    void gather_blocks(T* out, const unsigned char* src, std::ptrdiff_t stride,
+        const size_t* indices, size_t n, size_t blockSize)
+    {
+        for(size_t k = 0; k < n; ++k)
+        {
+            if(k + 1 < n)
+                prefetch(src + indices[k + 1] * stride);
+            const T* block = reinterpret_cast<const T*>(src + indices[k] * stride);
+            std::copy(block, block + blockSize, out + k * blockSize);
+        }
+    }
+
+    inline void checkIndices(const size_t* indices, size_t n, size_t size)
+    {
+        for(size_t k = 0; k < n; ++k)
+            if(indices[k] >= size)
+                throw std::invalid_argument("index out of range");
+    }
+}
+
+/// Elements of arr at the given indices along axis. The result has the
+/// shape of arr with axis replaced by the shape of indices.
+template<typename T>
+Array<T> take(const Array<T>& arr, const Array<size_t>& indices, int axis=0)
+{
+    if(axis < 0)
+        axis += arr.ndims();
+
+    if(axis < 0 || axis >= arr.ndims())
+        throw std::invalid_argument("take: axis out of range");
+
+    Array<size_t> idx = indices.isContiguous() ? indices : copy(indices);
+    const size_t* pidx = idx.cont_begin();
+    const size_t n = idx.numElements();
+    detail::checkIndices(pidx, n, arr.shape()[axis]);
+
+    Shape outerShape(arr.shape().begin(), arr.shape().begin() + axis);
+    Shape innerShape(arr.shape().begin() + axis + 1, arr.shape().end());
+    Strides outerStrides(arr.strides().begin(), arr.strides().begin() + axis);
+    Strides innerStrides(arr.strides().begin() + axis + 1, arr.strides().end());
+    const size_t outer = prod(outerShape);
+    const size_t inner = prod(innerShape);
+    const std::ptrdiff_t stride = arr.strides()[axis];
+
+    Shape newShape(outerShape);
+    newShape.insert(newShape.end(), idx.shape().begin(), idx.shape().end());
+    newShape.insert(newShape.end(), innerShape.begin(), innerShape.end());
+    Array<T> res = empty<T>(newShape);
+    T* out = res.cont_begin();
+
+    const bool innerContiguous = innerStrides == contiguousStrides(innerShape, sizeof(T));
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(arr.data()) + arr.offset();
+
+    // Work is split over the (outer, index) pairs, so that taking rows of a
+    // matrix is parallel too.
+    parallel_for(0, outer * n, [&](size_t begin, size_t end)
+    {
+        for(size_t o = begin / n; o * n < end; ++o)
+        {
+            const size_t kBegin = std::max(begin, o * n) - o * n;
+            const size_t kEnd = std::min(end, (o + 1) * n) - o * n;
+            
+            std::ptrdiff_t outerOffset = 0;
+            std::vector<size_t> outerIndex = multiIndex(o, outerShape);
+            for(int i = 0; i < axis; ++i)
+                outerOffset += outerIndex[i] * outerStrides[i];
+            
+            const unsigned char* src = base + outerOffset;
+            T* dst = out + (o * n + kBegin) * inner;
+            
+            if(inner == 1)
+                detail::gather(dst, src, stride, pidx + kBegin, kEnd - kBegin);
+            else if(innerContiguous)
+                detail::gather_blocks(dst, src, stride, pidx + kBegin, kEnd - kBegin, inner);
+            else
+            {
+                for(size_t k = kBegin; k < kEnd; ++k)
+                {
+                    std::ptrdiff_t srcOffset = arr.offset() + outerOffset + pidx[k] * stride;
+                    ArrayRef<T> block(ArrayCore(innerShape, innerStrides, arr.manager(), srcOffset));
+                    ArrayRef<T> target(ArrayCore(innerShape, contiguousStrides(innerShape, sizeof(T)),
+                        res.manager(), (o * n + k) * inner * sizeof(T)));
+                    target = Array<T>(block);
+                }
+            }
+        }
+    }, std::max<size_t>(1, parallelThreshold / std::max<size_t>(1, inner)));
+    
+    return res;
+}
+
+/// Set the elements of arr at the given flat (C-order) indices to values.
+/// values is either a single element or has one element per index.
+template<typename T>
+void put(const Array<T>& arr, const Array<size_t>& indices, const Array<T>& values)
+{
+    Array<size_t> idx = indices.isContiguous() ? indices : copy(indices);
+    Array<T> vals = values.isContiguous() ? values : copy(values);
+    const size_t* pidx = idx.cont_begin();
+    const T* pvals = vals.cont_begin();
+    const size_t n = idx.numElements();
+    const size_t numValues = vals.numElements();
+
+    if(numValues != 1 && numValues != n)
+        throw std::invalid_argument("put: values must have one element or one per index");
+
+    detail::checkIndices(pidx, n, arr.numElements());
+
+    if(arr.isContiguous())
+    {
+        T* out = arr.cont_begin();
+        for(size_t k = 0; k < n; ++k)
+            out[pidx[k]] = pvals[numValues == 1 ? 0 : k];
+        return;
+    }
+
+    for(size_t k = 0; k < n; ++k)
+        arr(multiIndex(pidx[k], arr.shape())) = pvals[numValues == 1 ? 0 : k];
+}
+
+template<typename DT, typename Derived>
+Array<DT> ArrayBase<DT, Derived>::operator[](const Array<size_t>& indices) const
+{
+    return take(Array<DT>(_core), indices, 0);
+}
+
+}
+
+#endif
@@ -11,14 +11,25 @@
 namespace numcpp
 {
 
-inline std::vector<std::ptrdiff_t> contiguousStrides(const std::vector<size_t>& shape, size_t elemSize)
+inline std::vector<std::ptrdiff_t> contiguousStrides(const std::vector<size_t>& shape, size_t elemSize,
+    Order order=Order::C)
 {
     std::vector<std::ptrdiff_t> strides(shape.size());
+    std::ptrdiff_t prod = elemSize;
+    
+    if(order == Order::F)
+    {
+        for(size_t i = 0; i < shape.size(); ++i)
+        {
+            strides[i] = prod;
+            prod *= shape[i];
+        }
+        return strides;
+    }
     
     auto strides_it = strides.rbegin();
     auto strides_it_end = strides.rend();
     auto shape_it = shape.rbegin();
-    int prod = elemSize;
     
     for(; strides_it != strides_it_end; ++shape_it, ++strides_it)
     {
@@ -29,24 +40,72 @@ inline std::vector<std::ptrdiff_t> contiguousStrides(const std::vector<size_t>&
     return strides;
 }
 
+// Order::Keep has no layout to keep here and allocates in C order.
 template<typename T>
-Array<T> empty(const Shape& shape)
+Array<T> empty(const Shape& shape, Order order=Order::C)
 {
     size_t numElements = prod(shape);
     size_t size = numElements * sizeof(T);
     Manager::Ptr manager = SimpleManager::allocate(size);
-    auto strides = contiguousStrides(shape, sizeof(T));
+    auto strides = contiguousStrides(shape, sizeof(T), order);
     
     ArrayCore core(shape, strides, manager, 0);
     
     return Array<T>(core);
 }
 
+// Row padding of pitched allocations.
+//  - None: rows are packed as in empty().
+//  - Align: every row starts on a cache line.
+//  - AvoidAliasing: as Align, and rows spanning a multiple of four cache
+//    lines get one more line, so that walking down a column does not keep
+//    hitting the same few cache sets (e.g. power-of-two widths).
+enum class Padding {None, Align, AvoidAliasing};
+
+constexpr size_t cacheLineSize = 64;
+
+// C-order strides in which every axis but the innermost is padded.
+inline Strides pitchedStrides(const Shape& shape, size_t elemSize, Padding padding)
+{
+    if(padding == Padding::None)
+        return contiguousStrides(shape, elemSize);
+    
+    // Padding is done in whole elements.
+    const size_t unit = cacheLineSize % elemSize == 0 ? cacheLineSize : elemSize;
+    
+    Strides strides(shape.size());
+    size_t stride = elemSize;
+    for(int i = int(shape.size()) - 1; i >= 0; --i)
+    {
+        strides[i] = stride;
+        
+        size_t extent = ceil_div(std::max<size_t>(1, stride * shape[i]), unit) * unit;
+        if(padding == Padding::AvoidAliasing && (extent / unit) % 4 == 0)
+            extent += unit;
+        stride = extent;
+    }
+    
+    return strides;
+}
+
+// Array with padded rows (and planes). The result is a regular strided C-order
+// array, aligned to a cache line, that is not contiguous unless padding is
+// Padding::None.
+template<typename T>
+Array<T> empty_pitched(const Shape& shape, Padding padding=Padding::AvoidAliasing)
+{
+    Strides strides = pitchedStrides(shape, sizeof(T), padding);
+    size_t size = shape.empty() ? sizeof(T) : strides[0] * shape[0];
+    Manager::Ptr manager = SimpleManager::allocate(size, cacheLineSize);
+    
+    return Array<T>(ArrayCore(shape, strides, manager, 0));
+}
+
 template<typename T>
-Array<T> zeros(const Shape& shape)
+Array<T> zeros(const Shape& shape, Order order=Order::C)
 {
-    Array<T> res = empty<T>(shape);
-    res.deep() = T(0);
+    Array<T> res = empty<T>(shape, order);
+    std::fill(res.cont_begin(), res.cont_end(), T(0));
     return res;
 }
 
@@ -57,10 +116,10 @@ Array<T> zeros_like(const Array<T>& arr)
 }
 
 template<typename T>
-Array<T> ones(const Shape& shape)
+Array<T> ones(const Shape& shape, Order order=Order::C)
 {
-    Array<T> res = empty<T>(shape);
-    res.deep() = T(1);
+    Array<T> res = empty<T>(shape, order);
+    std::fill(res.cont_begin(), res.cont_end(), T(1));
     return res;
 }
 
@@ -92,11 +151,21 @@ Array<T>::Array(const T& value)
 {}
 
 
+// Deep copy. With Order::Keep the copy is F-contiguous if the input is
+// F-contiguous and C-contiguous otherwise.
 template<typename T>
-Array<T> copy(const Array<T>& in)
+Array<T> copy(const Array<T>& in, Order order=Order::C)
 {
-    Array<T> res = empty<T>(in.shape());
-    res.deep() = in;
+    if(order == Order::Keep)
+        order = in.order();
+    
+    Array<T> res = empty<T>(in.shape(), order);
+    if(in.isDense() && in.order() == order)
+        std::copy(in.cont_begin(), in.cont_end(), res.cont_begin());
+    else if(order == Order::C && detail::hasUnitInnerStride(in))
+        detail::copy_rows(res, in);
+    else
+        res.deep() = in;
     return res;
 }
 
@@ -178,19 +247,150 @@ Array<T> broadcast(const Array<T>& array, const Shape& newShape)
     return Array<T>(ArrayCore(newShape, newStrides, array.manager(), array.offset()));
 }
 
+namespace detail
+{
+    // Strides that let an array with the given layout be seen with newShape,
+    // following the given index order. Returns false when that would need a
+    // copy. Adapted from NumPy's _attempt_nocopy_reshape.
+    inline bool reshapeStrides(const Shape& shape, const Strides& strides,
+        const Shape& newShape, size_t elemSize, Order order, Strides& newStrides)
+    {
+        // Axes of length 1 do not constrain the layout.
+        Shape oldShape;
+        Strides oldStrides;
+        for(size_t i = 0; i < shape.size(); ++i)
+        {
+            if(shape[i] != 1)
+            {
+                oldShape.push_back(shape[i]);
+                oldStrides.push_back(strides[i]);
+            }
+        }
+        
+        const size_t oldnd = oldShape.size();
+        const size_t newnd = newShape.size();
+        newStrides.assign(newnd, 0);
+        
+        size_t oi = 0, oj = 1, ni = 0, nj = 1;
+        while(ni < newnd && oi < oldnd)
+        {
+            size_t np = newShape[ni];
+            size_t op = oldShape[oi];
+            
+            while(np != op)
+            {
+                if(np < op)
+                    np *= newShape[nj++];
+                else
+                    op *= oldShape[oj++];
+            }
+            
+            // The merged old axes must be contiguous among themselves.
+            for(size_t ok = oi; ok + 1 < oj; ++ok)
+            {
+                if(order == Order::F)
+                {
+                    if(oldStrides[ok+1] != std::ptrdiff_t(oldShape[ok]) * oldStrides[ok])
+                        return false;
+                }
+                else
+                {
+                    if(oldStrides[ok] != std::ptrdiff_t(oldShape[ok+1]) * oldStrides[ok+1])
+                        return false;
+                }
+            }
+            
+            if(order == Order::F)
+            {
+                newStrides[ni] = oldStrides[oi];
+                for(size_t nk = ni + 1; nk < nj; ++nk)
+                    newStrides[nk] = newStrides[nk-1] * newShape[nk-1];
+            }
+            else
+            {
+                newStrides[nj-1] = oldStrides[oj-1];
+                for(size_t nk = nj - 1; nk > ni; --nk)
+                    newStrides[nk-1] = newStrides[nk] * newShape[nk];
+            }
+            
+            ni = nj++;
+            oi = oj++;
+        }
+        
+        // Trailing axes of length 1.
+        std::ptrdiff_t lastStride = elemSize;
+        if(ni >= 1)
+        {
+            lastStride = newStrides[ni-1];
+            if(order == Order::F)
+                lastStride *= newShape[ni-1];
+        }
+        for(size_t nk = ni; nk < newnd; ++nk)
+            newStrides[nk] = lastStride;
+        
+        return true;
+    }
+    
+    template<typename T>
+    Array<T> reversedAxes(const Array<T>& array)
+    {
+        return Array<T>(ArrayCore(Shape(array.shape().rbegin(), array.shape().rend()),
+            Strides(array.strides().rbegin(), array.strides().rend()),
+            array.manager(), array.offset()));
+    }
+}
+
+// Reshape without copying. Throws if the new shape cannot be expressed with
+// strides over the current data. Order::Keep reads in Fortran order only
+// when the array is F-contiguous and not C-contiguous.
 template<typename T>
-Array<T> reshape(const Array<T>& array, const Shape& newShape)
+Array<T> reshape_nocopy(const Array<T>& array, const Shape& newShape, Order order=Order::C)
 {
+    if(order == Order::Keep)
+        order = array.order();
+    
     if(array.numElements() != prod(newShape))
         throw std::invalid_argument("total size of the array must be unchanged");
     
-    if(!array.isContiguous())
-        return reshape(copy(array), newShape);
+    Strides newStrides;
+    if(array.numElements() == 0)
+        newStrides = contiguousStrides(newShape, sizeof(T), order);
+    else if(!detail::reshapeStrides(array.shape(), array.strides(), newShape, sizeof(T), order, newStrides))
+        throw std::invalid_argument("reshape_nocopy: the array cannot be reshaped without copying");
     
-    Strides newStrides = contiguousStrides(newShape, sizeof(T));
     return Array<T>(ArrayCore(newShape, newStrides, array.manager(), array.offset()));
 }
 
+// Reshape returning a view whenever the new shape can be expressed with
+// strides over the current data, and a reshaped copy otherwise. Elements are
+// read and placed following the given index order.
+template<typename T>
+Array<T> reshape(const Array<T>& array, const Shape& newShape, Order order=Order::C)
+{
+    if(order == Order::Keep)
+        order = array.order();
+    
+    if(array.numElements() != prod(newShape))
+        throw std::invalid_argument("total size of the array must be unchanged");
+    
+    Strides newStrides;
+    if(array.numElements() == 0)
+        return reshape_nocopy(array, newShape, order);
+    
+    if(detail::reshapeStrides(array.shape(), array.strides(), newShape, sizeof(T), order, newStrides))
+        return Array<T>(ArrayCore(newShape, newStrides, array.manager(), array.offset()));
+    
+    if(order == Order::F)
+    {
+        // A Fortran-order reshape is a C-order reshape of the reversed axes.
+        Array<T> reversed = copy(detail::reversedAxes(array));
+        Shape reversedShape(newShape.rbegin(), newShape.rend());
+        return detail::reversedAxes(reshape_nocopy(reversed, reversedShape));
+    }
+    
+    return reshape_nocopy(copy(array), newShape);
+}
+
 }
 
 #endif
@@ -141,28 +141,53 @@ private:
     unsigned char* _innerEnd;
 };
 
+// Iterates over the slabs of an array along a given axis. A single slab
+// array is built on construction; advancing only moves its offset.
 template<typename T, typename Derived>
 class SliceIterator
 {
 protected:
     SliceIterator(const ArrayBase<T, Derived>& array, int axis)
-        : _array(array), _axis(axis), _index(0)
+        : _array(&array)
+        , _slab(slabCore(array, axis))
+        , _baseOffset(array.offset())
+        , _step(array.strides()[axis])
+        , _axis(axis)
+        , _index(0)
     {}
     
     template<typename T2, typename Derived2>
     friend class ArrayBase;
     
+    static ArrayCore slabCore(const ArrayBase<T, Derived>& array, int axis)
+    {
+        Shape shape(array.shape());
+        Strides strides(array.strides());
+        shape.erase(shape.begin() + axis);
+        strides.erase(strides.begin() + axis);
+        return ArrayCore(std::move(shape), std::move(strides), array.manager(), array.offset());
+    }
+    
 public:
     
     SliceIterator(const SliceIterator& rhs)
-        : _array(rhs._array), _axis(rhs._axis), _index(rhs._index)
+        : _array(rhs._array)
+        , _slab(rhs._slab)
+        , _baseOffset(rhs._baseOffset)
+        , _step(rhs._step)
+        , _axis(rhs._axis)
+        , _index(rhs._index)
     {}
     
     SliceIterator& operator=(const SliceIterator& rhs)
     {
         _array = rhs._array;
+        _slab = rhs._slab;
+        _baseOffset = rhs._baseOffset;
+        _step = rhs._step;
         _axis = rhs._axis;
         _index = rhs._index;
+        return *this;
     }
     
     SliceIterator& operator++()
@@ -171,33 +196,35 @@ public:
         return *this;
     }
     
-    SliceIterator& operator++(int)
+    SliceIterator operator++(int)
     {
         SliceIterator aux(*this);
         ++(*this);
         return aux;
     }
     
-    Array<T> operator*()
+    /// The returned slab is reused and changes when the iterator advances.
+    const Array<T>& operator*()
     {
-        std::vector<Index> index(_axis+1, S{});
-        index[_axis] = Index(_index);
-        
-        return _array[index];
+        _slab.core().setOffset(_baseOffset + _index * _step);
+        return _slab;
     }
     
     bool operator==(const SliceIterator& rhs)
     {
-        return _index == rhs._index && _axis == rhs._axis && &_array == &rhs._array;
+        return _index == rhs._index && _axis == rhs._axis && _array == rhs._array;
     }
     
     bool operator!=(const SliceIterator& rhs)
     {
-        return _index != rhs._index || _axis != rhs._axis || &_array != &rhs._array;
+        return _index != rhs._index || _axis != rhs._axis || _array != rhs._array;
     }
     
 private:
-    const ArrayBase<T, Derived>& _array;
+    const ArrayBase<T, Derived>* _array;
+    Array<T> _slab;
+    std::ptrdiff_t _baseOffset;
+    std::ptrdiff_t _step;
     int _axis;
     int _index;
 };
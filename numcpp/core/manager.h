@@ -3,6 +3,7 @@
 #define NUMCPP_MANAGER_H
 
 #include <memory>
+#include <cstdint>
 
 namespace numcpp
 {
@@ -31,20 +32,30 @@ class SimpleManager : public Manager
 {
 private:
     std::unique_ptr<unsigned char[]> _array;
+    unsigned char* _data;
     
-    explicit SimpleManager(size_t size)
-        : _array(new unsigned char[size])
-    {}
+    explicit SimpleManager(size_t size, size_t alignment)
+        : _array(new unsigned char[size + alignment])
+        , _data(_array.get())
+    {
+        if(alignment > 1)
+        {
+            size_t misalignment = reinterpret_cast<std::uintptr_t>(_data) % alignment;
+            if(misalignment != 0)
+                _data += alignment - misalignment;
+        }
+    }
     
 public:
     
-    static Manager::Ptr allocate(size_t size)
+    // The data is aligned to alignment bytes when it is given.
+    static Manager::Ptr allocate(size_t size, size_t alignment=0)
     {
-        Manager::Ptr r(new SimpleManager(size));
+        Manager::Ptr r(new SimpleManager(size, alignment));
         return r;
     }
     
-    virtual unsigned char* data() const {return _array.get();}    
+    virtual unsigned char* data() const {return _data;}
 };
 
 struct NullOwner {};
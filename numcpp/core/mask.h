@@ -0,0 +1,267 @@
+
+#ifndef NUMCPP_MASK_H
+#define NUMCPP_MASK_H
+
+#include <cstring>
+#include <cstdint>
+
+#include "parallel.h"
+
+namespace numcpp
+{
+
+namespace detail
+{
+    // Chunk size used to split masked kernels; every chunk but the last has
+    // exactly this size so that per-chunk counts can be prefix-summed.
+    inline size_t maskChunkSize(size_t n)
+    {
+        return std::max<size_t>(parallelThreshold, ceil_div<size_t>(n, ThreadPool::instance().concurrency()));
+    }
+
+    template<typename Function>
+    void for_each_chunk(size_t n, Function&& f)
+    {
+        const size_t chunkSize = maskChunkSize(n);
+        const size_t numChunks = n == 0 ? 0 : ceil_div(n, chunkSize);
+        parallel_for(0, numChunks, [&](size_t begin, size_t end)
+        {
+            for(size_t c = begin; c < end; ++c)
+                f(c, c * chunkSize, std::min(n, (c + 1) * chunkSize));
+        });
+    }
+
+    // Eight mask bytes at once. bool is stored as 0 or 1.
+    inline std::uint64_t maskWord(const bool* m)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, m, sizeof(word));
+        return word;
+    }
+
+    constexpr std::uint64_t allTrueWord = 0x0101010101010101ull;
+
+    inline size_t countTrue(const bool* m, size_t n)
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < n; ++i)
+            count += m[i];
+        return count;
+    }
+
+    // Copy the elements of in selected by m to out. Blocks of eight mask
+    // bytes that are all false or all true skip the per-element branch.
+    template<typename T>
+    void compact(T* out, const T* in, const bool* m, size_t n)
+    {
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            const std::uint64_t word = maskWord(m + i);
+            if(word == 0)
+                continue;
+
+            if(word == allTrueWord)
+            {
+                std::copy(in + i, in + i + 8, out);
+                out += 8;
+                continue;
+            }
+
+            for(size_t j = i; j < i + 8; ++j)
+                if(m[j])
+                    *out++ = in[j];
+        }
+
+        for(; i < n; ++i)
+            if(m[i])
+                *out++ = in[i];
+    }
+
+    // Inverse of compact: write consecutive values to the selected places.
+    template<typename T>
+    void expand(T* out, const T* in, const bool* m, size_t n)
+    {
+        for(size_t i = 0; i < n; ++i)
+            if(m[i])
+                out[i] = *in++;
+    }
+
+    // Number of selected elements of every chunk, turned into the position
+    // of the first selected element of every chunk.
+    inline std::vector<size_t> chunkOffsets(const bool* m, size_t n)
+    {
+        const size_t chunkSize = maskChunkSize(n);
+        std::vector<size_t> offsets(n == 0 ? 1 : ceil_div(n, chunkSize) + 1, 0);
+
+        for_each_chunk(n, [&](size_t c, size_t begin, size_t end)
+        {
+            offsets[c+1] = countTrue(m + begin, end - begin);
+        });
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        return offsets;
+    }
+
+    inline void checkMask(const Shape& shape, const Array<bool>& mask)
+    {
+        if(mask.shape() != shape)
+            throw std::invalid_argument("the mask must have the same shape as the array");
+    }
+}
+
+inline size_t count_nonzero(const Array<bool>& mask)
+{
+    Array<bool> m = mask.isDense() ? mask : copy(mask);
+    const bool* data = m.cont_begin();
+
+    std::vector<size_t> counts(ceil_div<size_t>(std::max<size_t>(1, m.numElements()), detail::maskChunkSize(m.numElements())), 0);
+    detail::for_each_chunk(m.numElements(), [&](size_t c, size_t begin, size_t end)
+    {
+        counts[c] = detail::countTrue(data + begin, end - begin);
+    });
+
+    return std::accumulate(counts.begin(), counts.end(), size_t(0));
+}
+
+/// Elementwise selection: a where mask is true, b elsewhere. The three
+/// arrays are broadcasted together.
+template<typename T>
+Array<T> where(const Array<bool>& mask, const Array<T>& a, const Array<T>& b)
+{
+    if(mask.shape() == a.shape() && a.shape() == b.shape()
+        && mask.isContiguous() && a.isContiguous() && b.isContiguous())
+    {
+        Array<T> res = empty<T>(a.shape());
+        const bool* m = mask.cont_begin();
+        const T* pa = a.cont_begin();
+        const T* pb = b.cont_begin();
+        T* out = res.cont_begin();
+
+        detail::for_each_chunk(res.numElements(), [&](size_t, size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; ++i)
+                out[i] = m[i] ? pa[i] : pb[i];
+        });
+        return res;
+    }
+
+    return array_map([](bool m, const T& x, const T& y){return m ? x : y;}, mask, a, b);
+}
+
+/// 1-D array with the elements of arr where mask is true, in C order.
+template<typename T>
+Array<T> compress(const Array<T>& arr, const Array<bool>& mask)
+{
+    detail::checkMask(arr.shape(), mask);
+
+    Array<T> src = arr.isContiguous() ? arr : copy(arr);
+    Array<bool> m = mask.isContiguous() ? mask : copy(mask);
+    const size_t n = src.numElements();
+
+    const std::vector<size_t> offsets = detail::chunkOffsets(m.cont_begin(), n);
+    Array<T> res = empty<T>({offsets.back()});
+
+    const T* in = src.cont_begin();
+    const bool* pm = m.cont_begin();
+    T* out = res.cont_begin();
+    detail::for_each_chunk(n, [&](size_t c, size_t begin, size_t end)
+    {
+        detail::compact(out + offsets[c], in + begin, pm + begin, end - begin);
+    });
+
+    return res;
+}
+
+template<typename DT, typename Derived>
+Array<DT> ArrayBase<DT, Derived>::operator[](const Array<bool>& mask) const
+{
+    return compress(Array<DT>(_core), mask);
+}
+
+/// Target of a masked assignment, see ArrayBase::masked().
+template<typename T>
+class MaskedArray
+{
+public:
+    MaskedArray(const Array<T>& array, const Array<bool>& mask)
+        : _array(array), _mask(mask)
+    {
+        detail::checkMask(array.shape(), mask);
+    }
+
+    /// Set every selected element to value.
+    MaskedArray& operator=(const T& value)
+    {
+        if(_array.isContiguous() && _mask.isContiguous())
+        {
+            T* out = _array.cont_begin();
+            const bool* m = _mask.cont_begin();
+            detail::for_each_chunk(_array.numElements(), [&](size_t, size_t begin, size_t end)
+            {
+                for(size_t i = begin; i < end; ++i)
+                    if(m[i])
+                        out[i] = value;
+            });
+            return *this;
+        }
+
+        Array<T> arr(_array);
+        Array<bool> mask(_mask);
+        for(auto elems : zip(arr, mask))
+            if(std::get<1>(elems))
+                std::get<0>(elems) = value;
+
+        return *this;
+    }
+
+    /// Scatter the 1-D array values, in C order, to the selected elements.
+    /// values must have as many elements as the mask has true values.
+    MaskedArray& operator=(const Array<T>& values)
+    {
+        Array<bool> m = _mask.isContiguous() ? _mask : copy(_mask);
+        const size_t n = m.numElements();
+        const std::vector<size_t> offsets = detail::chunkOffsets(m.cont_begin(), n);
+
+        if(values.ndims() != 1 || size_t(values.numElements()) != offsets.back())
+            throw std::invalid_argument("masked assignment needs as many values as true elements in the mask");
+
+        Array<T> src = values.isContiguous() ? values : copy(values);
+        const T* in = src.cont_begin();
+        const bool* pm = m.cont_begin();
+
+        if(_array.isContiguous())
+        {
+            T* out = _array.cont_begin();
+            detail::for_each_chunk(n, [&](size_t c, size_t begin, size_t end)
+            {
+                detail::expand(out + begin, in + offsets[c], pm + begin, end - begin);
+            });
+            return *this;
+        }
+
+        Array<T> arr(_array);
+        size_t i = 0;
+        for(auto& x : arr)
+        {
+            if(*pm++)
+                x = in[i++];
+        }
+
+        return *this;
+    }
+
+private:
+    Array<T> _array;
+    Array<bool> _mask;
+};
+
+template<typename DT, typename Derived>
+MaskedArray<DT> ArrayBase<DT, Derived>::masked(const Array<bool>& mask) const
+{
+    return MaskedArray<DT>(Array<DT>(_core), mask);
+}
+
+}
+
+#endif
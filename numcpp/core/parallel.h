@@ -0,0 +1,179 @@
+
+#ifndef NUMCPP_PARALLEL_H
+#define NUMCPP_PARALLEL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <exception>
+
+#include "utils.h"
+
+namespace numcpp
+{
+
+/// Fixed-size pool of worker threads used by the parallel kernels.
+///
+/// Jobs are plain closures executed in FIFO order. parallel_for is the main
+/// entry point; calls made from inside a worker run serially, so kernels can
+/// be nested without deadlocking the pool.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t numThreads)
+        : _stop(false)
+    {
+        for(size_t i = 0; i < numThreads; ++i)
+            _workers.emplace_back([this]{workerLoop();});
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+
+        for(auto& worker : _workers)
+            worker.join();
+    }
+
+    /// Number of threads taking part in a parallel_for (workers plus caller).
+    size_t concurrency() const {return _workers.size() + 1;}
+
+    void submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(std::move(job));
+        }
+        _condition.notify_one();
+    }
+
+    /// Split [begin, end) in at most concurrency() chunks of at least
+    /// minChunk elements and call f(chunkBegin, chunkEnd) on each of them.
+    template<typename Function>
+    void parallel_for(size_t begin, size_t end, Function&& f, size_t minChunk = 1)
+    {
+        if(end <= begin)
+            return;
+
+        const size_t size = end - begin;
+        size_t numChunks = std::min(concurrency(), std::max<size_t>(1, size / std::max<size_t>(1, minChunk)));
+        if(insideWorker())
+            numChunks = 1;
+
+        if(numChunks == 1)
+        {
+            f(begin, end);
+            return;
+        }
+
+        const size_t chunkSize = ceil_div(size, numChunks);
+        numChunks = ceil_div(size, chunkSize);
+
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        size_t pending = numChunks - 1;
+        std::exception_ptr error;
+
+        for(size_t c = 1; c < numChunks; ++c)
+        {
+            const size_t chunkBegin = begin + c * chunkSize;
+            const size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+            submit([&, chunkBegin, chunkEnd]
+            {
+                std::exception_ptr chunkError;
+                try
+                {
+                    f(chunkBegin, chunkEnd);
+                }
+                catch(...)
+                {
+                    chunkError = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if(chunkError)
+                    error = chunkError;
+                if(--pending == 0)
+                    doneCondition.notify_one();
+            });
+        }
+
+        try
+        {
+            f(begin, std::min(end, begin + chunkSize));
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&pending]{return pending == 0;});
+
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+private:
+    static bool& insideWorker()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void workerLoop()
+    {
+        insideWorker() = true;
+
+        while(true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]{return _stop || !_jobs.empty();});
+                if(_stop && _jobs.empty())
+                    return;
+
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()> > _jobs;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop;
+};
+
+// Below this number of elements kernels do not bother with threads.
+constexpr size_t parallelThreshold = 1 << 16;
+
+template<typename Function>
+void parallel_for(size_t begin, size_t end, Function&& f, size_t minChunk = 1)
+{
+    ThreadPool::instance().parallel_for(begin, end, std::forward<Function>(f), minChunk);
+}
+
+}
+
+#endif
@@ -0,0 +1,303 @@
+
+#ifndef NUMCPP_PLANAR_H
+#define NUMCPP_PLANAR_H
+
+#include <complex>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace numcpp
+{
+
+/// Real part of an interleaved complex array, as a strided view.
+template<typename T>
+Array<T> real(const Array<std::complex<T> >& arr)
+{
+    return Array<T>(ArrayCore(arr.shape(), arr.strides(), arr.manager(), arr.offset()));
+}
+
+/// Imaginary part of an interleaved complex array, as a strided view.
+template<typename T>
+Array<T> imag(const Array<std::complex<T> >& arr)
+{
+    return Array<T>(ArrayCore(arr.shape(), arr.strides(), arr.manager(), arr.offset() + sizeof(T)));
+}
+
+/// Complex array with the real and imaginary parts in separate planes.
+///
+/// Both planes are C-contiguous arrays of T, so elementwise kernels work on
+/// plain arrays of reals instead of interleaved pairs. Arrays created here
+/// keep both planes in a single allocation, imaginary after real.
+template<typename T>
+class PlanarComplex
+{
+public:
+    PlanarComplex() {}
+
+    /// Uninitialized planar array.
+    explicit PlanarComplex(const Shape& shape)
+    {
+        const size_t numElements = prod(shape);
+        Manager::Ptr manager = SimpleManager::allocate(2 * numElements * sizeof(T));
+        const Strides strides = contiguousStrides(shape, sizeof(T));
+        _real = Array<T>(ArrayCore(shape, strides, manager, 0));
+        _imag = Array<T>(ArrayCore(shape, strides, manager, numElements * sizeof(T)));
+    }
+
+    /// Planar array from its two planes, which are copied only if they are
+    /// not C-contiguous.
+    PlanarComplex(const Array<T>& real, const Array<T>& imag)
+        : _real(real.isContiguous() ? real : copy(real))
+        , _imag(imag.isContiguous() ? imag : copy(imag))
+    {
+        if(real.shape() != imag.shape())
+            throw std::invalid_argument("the real and imaginary parts must have the same shape");
+    }
+
+    const Shape& shape() const {return _real.shape();}
+    int ndims() const {return _real.ndims();}
+    size_t numElements() const {return _real.numElements();}
+
+    const Array<T>& real() const {return _real;}
+    const Array<T>& imag() const {return _imag;}
+
+    std::complex<T> operator()(const std::vector<size_t>& index) const
+    {
+        return std::complex<T>(_real(index), _imag(index));
+    }
+
+private:
+    Array<T> _real;
+    Array<T> _imag;
+};
+
+template<typename T>
+const Array<T>& real(const PlanarComplex<T>& arr) {return arr.real();}
+
+template<typename T>
+const Array<T>& imag(const PlanarComplex<T>& arr) {return arr.imag();}
+
+/// Planar copy of an interleaved complex array.
+template<typename T>
+PlanarComplex<T> to_planar(const Array<std::complex<T> >& arr)
+{
+    PlanarComplex<T> res(arr.shape());
+    ArrayRef<T>(res.real()) = real(arr);
+    ArrayRef<T>(res.imag()) = imag(arr);
+    return res;
+}
+
+/// Interleaved copy of a planar complex array.
+template<typename T>
+Array<std::complex<T> > to_interleaved(const PlanarComplex<T>& arr)
+{
+    Array<std::complex<T> > res = empty<std::complex<T> >(arr.shape());
+    T* out = reinterpret_cast<T*>(res.data());
+    const T* re = arr.real().cont_begin();
+    const T* im = arr.imag().cont_begin();
+    parallel_for(0, arr.numElements(), [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            out[2*i] = re[i];
+            out[2*i+1] = im[i];
+        }
+    }, parallelThreshold);
+    return res;
+}
+
+namespace detail
+{
+    template<typename T>
+    void checkSameShape(const PlanarComplex<T>& a, const PlanarComplex<T>& b)
+    {
+        if(a.shape() != b.shape())
+            throw std::invalid_argument("planar complex arrays must have the same shape");
+    }
+
+    // res = f(a, b) elementwise, with f working on the four real planes.
+    template<typename T, typename Function>
+    PlanarComplex<T> planar_map(const PlanarComplex<T>& a, const PlanarComplex<T>& b, Function f)
+    {
+        checkSameShape(a, b);
+
+        PlanarComplex<T> res(a.shape());
+        const T* ar = a.real().cont_begin();
+        const T* ai = a.imag().cont_begin();
+        const T* br = b.real().cont_begin();
+        const T* bi = b.imag().cont_begin();
+        T* re = res.real().cont_begin();
+        T* im = res.imag().cont_begin();
+        parallel_for(0, res.numElements(), [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; ++i)
+                f(ar[i], ai[i], br[i], bi[i], re[i], im[i]);
+        }, parallelThreshold);
+        return res;
+    }
+}
+
+template<typename T>
+PlanarComplex<T> operator+(const PlanarComplex<T>& a, const PlanarComplex<T>& b)
+{
+    return detail::planar_map(a, b, [](T ar, T ai, T br, T bi, T& re, T& im)
+    {
+        re = ar + br;
+        im = ai + bi;
+    });
+}
+
+template<typename T>
+PlanarComplex<T> operator-(const PlanarComplex<T>& a, const PlanarComplex<T>& b)
+{
+    return detail::planar_map(a, b, [](T ar, T ai, T br, T bi, T& re, T& im)
+    {
+        re = ar - br;
+        im = ai - bi;
+    });
+}
+
+template<typename T>
+PlanarComplex<T> operator*(const PlanarComplex<T>& a, const PlanarComplex<T>& b)
+{
+    return detail::planar_map(a, b, [](T ar, T ai, T br, T bi, T& re, T& im)
+    {
+        re = ar * br - ai * bi;
+        im = ar * bi + ai * br;
+    });
+}
+
+template<typename T>
+PlanarComplex<T> operator*(const std::complex<T>& s, const PlanarComplex<T>& a)
+{
+    const T sr = s.real(), si = s.imag();
+    return detail::planar_map(a, a, [sr, si](T ar, T ai, T, T, T& re, T& im)
+    {
+        re = sr * ar - si * ai;
+        im = sr * ai + si * ar;
+    });
+}
+
+template<typename T>
+PlanarComplex<T> exp(const PlanarComplex<T>& a)
+{
+    return detail::planar_map(a, a, [](T ar, T ai, T, T, T& re, T& im)
+    {
+        const T e = std::exp(ar);
+        re = e * std::cos(ai);
+        im = e * std::sin(ai);
+    });
+}
+
+template<typename T>
+std::complex<T> sum(const PlanarComplex<T>& a)
+{
+    const T* re = a.real().cont_begin();
+    const T* im = a.imag().cont_begin();
+    return std::complex<T>(std::accumulate(re, re + a.numElements(), T(0)),
+        std::accumulate(im, im + a.numElements(), T(0)));
+}
+
+namespace detail
+{
+    // In-place radix-2 FFT of one row of length n (a power of two) given as
+    // two planes. tr/ti hold the n/2 twiddle factors exp(-2 pi i k / n).
+    template<typename T>
+    void fft_row(T* re, T* im, size_t n, const T* tr, const T* ti, bool inverse)
+    {
+        for(size_t i = 1, j = 0; i < n; ++i)
+        {
+            size_t bit = n >> 1;
+            for(; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if(i < j)
+            {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+
+        for(size_t len = 2; len <= n; len <<= 1)
+        {
+            const size_t half = len / 2;
+            const size_t step = n / len;
+            for(size_t start = 0; start < n; start += len)
+            {
+                for(size_t k = 0; k < half; ++k)
+                {
+                    const T wr = tr[k * step];
+                    const T wi = inverse ? -ti[k * step] : ti[k * step];
+                    const size_t a = start + k, b = a + half;
+                    const T xr = re[b] * wr - im[b] * wi;
+                    const T xi = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - xr;
+                    im[b] = im[a] - xi;
+                    re[a] += xr;
+                    im[a] += xi;
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    PlanarComplex<T> fft(const PlanarComplex<T>& a, bool inverse)
+    {
+        const size_t n = a.ndims() > 0 ? a.shape().back() : 1;
+        if(n == 0 || (n & (n - 1)) != 0)
+            throw std::invalid_argument("fft: the length of the last axis must be a power of two");
+
+        PlanarComplex<T> res(a.shape());
+        ArrayRef<T>(res.real()) = a.real();
+        ArrayRef<T>(res.imag()) = a.imag();
+
+        const double twoPi = 2 * std::acos(-1.0);
+        std::vector<T> tr(n / 2), ti(n / 2);
+        for(size_t k = 0; k < n / 2; ++k)
+        {
+            const double angle = -twoPi * k / n;
+            tr[k] = std::cos(angle);
+            ti[k] = std::sin(angle);
+        }
+
+        T* re = res.real().cont_begin();
+        T* im = res.imag().cont_begin();
+        const size_t numRows = res.numElements() / n;
+        const T scale = T(1) / n;
+        parallel_for(0, numRows, [&](size_t begin, size_t end)
+        {
+            for(size_t r = begin; r < end; ++r)
+            {
+                fft_row(re + r * n, im + r * n, n, tr.data(), ti.data(), inverse);
+                if(inverse)
+                    for(size_t i = r * n; i < (r + 1) * n; ++i)
+                    {
+                        re[i] *= scale;
+                        im[i] *= scale;
+                    }
+            }
+        }, std::max<size_t>(1, parallelThreshold / n));
+
+        return res;
+    }
+}
+
+/// Discrete Fourier transform along the last axis, whose length must be a
+/// power of two.
+template<typename T>
+PlanarComplex<T> fft(const PlanarComplex<T>& a)
+{
+    return detail::fft(a, false);
+}
+
+/// Inverse of fft, including the 1/n normalization.
+template<typename T>
+PlanarComplex<T> ifft(const PlanarComplex<T>& a)
+{
+    return detail::fft(a, true);
+}
+
+}
+
+#endif
@@ -89,7 +89,7 @@ public:
     const SliceElem& end() const {return _end;}
     int step() const {return _step;}
     
-    std::ptrdiff_t start(int shape) const
+    std::ptrdiff_t start(std::ptrdiff_t shape) const
     {
         if(_start.isUnit())
         {
@@ -99,12 +99,12 @@ public:
             return shape - 1;
         }
         
-        int v = _start.value();
+        std::ptrdiff_t v = _start.value();
         v = v >= 0 ? v : shape + v;
-        return clamp(v, 0, shape);
+        return clamp<std::ptrdiff_t>(v, 0, shape);
     }
     
-    std::ptrdiff_t end(int shape) const
+    std::ptrdiff_t end(std::ptrdiff_t shape) const
     {
         if(_end.isUnit())
         {
@@ -114,9 +114,9 @@ public:
             return -1;
         }
         
-        int v = _end.value();
+        std::ptrdiff_t v = _end.value();
         v = v >= 0 ? v : shape + v;
-        return clamp(v, 0, shape);
+        return clamp<std::ptrdiff_t>(v, 0, shape);
     }
     
 private:
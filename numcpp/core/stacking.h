@@ -0,0 +1,185 @@
+
+#ifndef NUMCPP_STACKING_H
+#define NUMCPP_STACKING_H
+
+#include "parallel.h"
+
+namespace numcpp
+{
+
+namespace detail
+{
+    // Copy a list of arrays into blocks of a preallocated output. Block k
+    // has the shape of arrays[k], the strides of out and starts at
+    // offsets[k]. Large jobs are split across the thread pool by block.
+    template<typename T>
+    void copy_blocks(const Array<T>& out, const std::vector<Array<T> >& arrays,
+        const std::vector<std::ptrdiff_t>& offsets)
+    {
+        auto copyBlock = [&](size_t k)
+        {
+            ArrayRef<T> block(ArrayCore(arrays[k].shape(), out.strides(), out.manager(), offsets[k]));
+            if(block.isContiguous() && arrays[k].isContiguous())
+                std::copy(arrays[k].cont_begin(), arrays[k].cont_end(), block.cont_begin());
+            else
+                block = arrays[k];
+        };
+
+        if(size_t(out.numElements()) < parallelThreshold)
+        {
+            for(size_t k = 0; k < arrays.size(); ++k)
+                copyBlock(k);
+            return;
+        }
+
+        parallel_for(0, arrays.size(), [&](size_t begin, size_t end)
+        {
+            for(size_t k = begin; k < end; ++k)
+                copyBlock(k);
+        });
+    }
+
+    inline int normalizeAxis(int axis, int ndims)
+    {
+        if(axis < 0)
+            axis += ndims;
+
+        if(axis < 0 || axis >= ndims)
+            throw std::invalid_argument("axis out of range");
+
+        return axis;
+    }
+
+    // View of arr with a new axis of length 1 inserted at axis.
+    template<typename T>
+    Array<T> expandDims(const Array<T>& arr, int axis)
+    {
+        Shape shape(arr.shape());
+        Strides strides(arr.strides());
+        shape.insert(shape.begin() + axis, 1);
+        strides.insert(strides.begin() + axis, 0);
+        return Array<T>(ArrayCore(shape, strides, arr.manager(), arr.offset()));
+    }
+}
+
+/// Join arrays along an existing axis. The output is allocated once and
+/// every input is block-copied into place.
+template<typename T>
+Array<T> concatenate(const std::vector<Array<T> >& arrays, int axis=0)
+{
+    if(arrays.empty())
+        throw std::invalid_argument("need at least one array to concatenate");
+
+    const Shape& first = arrays[0].shape();
+    axis = detail::normalizeAxis(axis, first.size());
+
+    Shape newShape(first);
+    newShape[axis] = 0;
+    for(auto& arr : arrays)
+    {
+        if(arr.ndims() != int(first.size()))
+            throw std::invalid_argument("all the input arrays must have the same number of dimensions");
+
+        for(int i = 0; i < arr.ndims(); ++i)
+            if(i != axis && arr.shape()[i] != first[i])
+                throw std::invalid_argument("all the input array dimensions except for the concatenation axis must match");
+
+        newShape[axis] += arr.shape()[axis];
+    }
+
+    Array<T> res = empty<T>(newShape);
+
+    std::vector<std::ptrdiff_t> offsets;
+    std::ptrdiff_t offset = 0;
+    for(auto& arr : arrays)
+    {
+        offsets.push_back(offset);
+        offset += arr.shape()[axis] * res.strides()[axis];
+    }
+
+    detail::copy_blocks(res, arrays, offsets);
+    return res;
+}
+
+/// Join arrays of the same shape along a new axis.
+template<typename T>
+Array<T> stack(const std::vector<Array<T> >& arrays, int axis=0)
+{
+    if(arrays.empty())
+        throw std::invalid_argument("need at least one array to stack");
+
+    axis = detail::normalizeAxis(axis, arrays[0].ndims() + 1);
+
+    std::vector<Array<T> > expanded;
+    for(auto& arr : arrays)
+    {
+        if(arr.shape() != arrays[0].shape())
+            throw std::invalid_argument("all input arrays must have the same shape");
+
+        expanded.push_back(detail::expandDims(arr, axis));
+    }
+
+    return concatenate(expanded, axis);
+}
+
+/// Stack arrays horizontally: along the second axis, or the first one for
+/// 1-D arrays.
+template<typename T>
+Array<T> hstack(const std::vector<Array<T> >& arrays)
+{
+    if(!arrays.empty() && arrays[0].ndims() == 1)
+        return concatenate(arrays, 0);
+
+    return concatenate(arrays, 1);
+}
+
+/// Stack arrays vertically. 1-D arrays of length N are taken as 1xN rows.
+template<typename T>
+Array<T> vstack(const std::vector<Array<T> >& arrays)
+{
+    std::vector<Array<T> > rows;
+    for(auto& arr : arrays)
+        rows.push_back(arr.ndims() == 1 ? detail::expandDims(arr, 0) : arr);
+
+    return concatenate(rows, 0);
+}
+
+/// Repeat arr reps[i] times along every axis i. Missing leading dimensions
+/// of either arr or reps are taken as 1.
+template<typename T>
+Array<T> tile(const Array<T>& arr, const Shape& reps)
+{
+    const int ndims = std::max<int>(arr.ndims(), reps.size());
+
+    Shape shape(ndims, 1);
+    Strides strides(ndims, 0);
+    Shape fullReps(ndims, 1);
+    std::copy(arr.shape().rbegin(), arr.shape().rend(), shape.rbegin());
+    std::copy(arr.strides().rbegin(), arr.strides().rend(), strides.rbegin());
+    std::copy(reps.rbegin(), reps.rend(), fullReps.rbegin());
+
+    Array<T> src(ArrayCore(shape, strides, arr.manager(), arr.offset()));
+
+    Shape newShape(ndims);
+    for(int i = 0; i < ndims; ++i)
+        newShape[i] = shape[i] * fullReps[i];
+
+    Array<T> res = empty<T>(newShape);
+
+    const size_t numTiles = prod(fullReps);
+    std::vector<Array<T> > arrays(numTiles, src);
+    std::vector<std::ptrdiff_t> offsets(numTiles, 0);
+    for(size_t k = 0; k < numTiles; ++k)
+    {
+        std::vector<size_t> tileIndex = multiIndex(k, fullReps);
+        for(int i = 0; i < ndims; ++i)
+            offsets[k] += tileIndex[i] * shape[i] * res.strides()[i];
+    }
+
+    detail::copy_blocks(res, arrays, offsets);
+    return res;
+}
+
+}
+
+#endif
@@ -17,6 +17,10 @@ namespace numcpp
 typedef std::vector<size_t> Shape;
 typedef std::vector<std::ptrdiff_t> Strides;
 
+// Memory layout of multidimensional data: row-major (C), column-major
+// (Fortran), or whatever layout the input already has (Keep).
+enum class Order {C, F, Keep};
+
 template<typename T>
 T clamp(T v, T lower, T upper)
 {
@@ -34,7 +38,19 @@ typename Array::value_type prod(Array x)
   return prod;
 }
 
-std::vector<size_t> multiIndex(const size_t& index, const Shape& shape);
+// Multidimensional C-order index of the flat index in an array of the given
+// shape.
+inline std::vector<size_t> multiIndex(const size_t& index, const Shape& shape)
+{
+    std::vector<size_t> res(shape.size());
+    size_t rest = index;
+    for(int i = int(shape.size()) - 1; i >= 0; --i)
+    {
+        res[i] = rest % shape[i];
+        rest /= shape[i];
+    }
+    return res;
+}
 
 size_t flatIndex(const std::vector<size_t>& index, const Strides& strides, size_t offset);
 
@@ -92,6 +108,26 @@ Strides seqStrides(const Shape& shape, const Strides& strides)
     return res;
 }
 
+typedef std::chrono::high_resolution_clock::time_point TimePoint;
+
+// Start a timer.
+inline TimePoint tic()
+{
+    return std::chrono::high_resolution_clock::now();
+}
+
+// Elapsed microseconds since t. Optionally prints them.
+inline size_t toc(const TimePoint& t, bool print=true)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - t).count();
+    
+    if(print)
+        std::cout << "Elapsed time: " << elapsed << " us" << std::endl;
+    
+    return elapsed;
+}
+
 // Ceil of the integer division a/b
 template<typename T>
 T ceil_div(const T& a, const T& b)
@@ -1,5 +1,7 @@
 #include "io/file.h"
 #include "io/hdf5.h"
+#include "io/npy.h"
+#include "io/stream.h"
 
 /*!
 @defgroup io IO
@@ -1,6 +1,13 @@
 #include "file.h"
 #include "../core.h"
 
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+
 namespace numcpp
 {
 
@@ -11,4 +18,382 @@ size_t filesize(std::string filename)
     return in.tellg();
 }
 
+namespace detail
+{
+
+InputFile::InputFile(const std::string& filename)
+    : _fd(open(filename.c_str(), O_RDONLY))
+{
+    if(_fd < 0)
+        throw std::runtime_error("cannot open " + filename);
+}
+
+InputFile::~InputFile()
+{
+    close(_fd);
+}
+
+template<typename Word, typename Swap>
+static void swapWords(void* data, size_t numWords, Swap swap)
+{
+    // Word by word through memcpy, so that data needs no alignment.
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    for(size_t i = 0; i < numWords; ++i)
+    {
+        Word w;
+        std::memcpy(&w, bytes + i*sizeof(Word), sizeof(Word));
+        w = swap(w);
+        std::memcpy(bytes + i*sizeof(Word), &w, sizeof(Word));
+    }
+}
+
+void byteswap(void* data, size_t numBytes, size_t width)
+{
+    switch(width)
+    {
+    case 1:
+        return;
+    case 2:
+        return swapWords<uint16_t>(data, numBytes / 2, [](uint16_t w){return __builtin_bswap16(w);});
+    case 4:
+        return swapWords<uint32_t>(data, numBytes / 4, [](uint32_t w){return __builtin_bswap32(w);});
+    case 8:
+        return swapWords<uint64_t>(data, numBytes / 8, [](uint64_t w){return __builtin_bswap64(w);});
+    }
+
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    for(size_t i = 0; i + width <= numBytes; i += width)
+        std::reverse(bytes + i, bytes + i + width);
+}
+
+void readAt(int fd, void* data, size_t size, size_t offset)
+{
+    char* out = static_cast<char*>(data);
+    while(size > 0)
+    {
+        ssize_t n = pread(fd, out, size, offset);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            throw std::runtime_error(n == 0 ? "unexpected end of file" : std::strerror(errno));
+
+        out += n;
+        offset += n;
+        size -= n;
+    }
+}
+
+// Blocks written by O_DIRECT are aligned to this size.
+static const size_t directAlignment = 4096;
+
+// Runs shorter than this are copied to the staging buffer rather than
+// given their own iovec.
+static const size_t minInPlaceWrite = 4096;
+
+static void writeAll(int fd, const void* data, size_t size)
+{
+    const char* in = static_cast<const char*>(data);
+    while(size > 0)
+    {
+        ssize_t n = ::write(fd, in, size);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            throw std::runtime_error(std::strerror(errno));
+
+        in += n;
+        size -= n;
+    }
+}
+
+// writev the whole of iov, resuming after short writes.
+static void writevAll(int fd, std::vector<iovec>& iov)
+{
+    size_t first = 0;
+    while(first < iov.size())
+    {
+        ssize_t n = writev(fd, &iov[first], std::min<size_t>(iov.size() - first, IOV_MAX));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            throw std::runtime_error(std::strerror(errno));
+
+        for(; first < iov.size() && size_t(n) >= iov[first].iov_len; ++first)
+            n -= iov[first].iov_len;
+        if(first < iov.size())
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+            iov[first].iov_len -= n;
+        }
+    }
+}
+
+OutputFile::OutputFile(const std::string& filename, bool direct)
+    : _fd(-1)
+    , _direct(false)
+    , _staging(SimpleManager::allocate(writeChunkSize, directAlignment))
+    , _staged(0)
+{
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    // Some file systems (tmpfs) refuse O_DIRECT; write through the page
+    // cache there.
+    if(direct)
+    {
+        _fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+        _direct = _fd >= 0;
+    }
+#endif
+    if(_fd < 0)
+        _fd = open(filename.c_str(), flags, 0644);
+    if(_fd < 0)
+        throw std::runtime_error("cannot open " + filename);
+}
+
+OutputFile::~OutputFile()
+{
+    if(_fd >= 0)
+        ::close(_fd);
+}
+
+void OutputFile::write(const void* data, size_t size)
+{
+    if(!_direct && size >= minInPlaceWrite)
+    {
+        if(_pending.size() >= IOV_MAX)
+            flush();
+        _pending.push_back(std::make_pair(data, size));
+        return;
+    }
+
+    const unsigned char* in = static_cast<const unsigned char*>(data);
+    while(size > 0)
+    {
+        const size_t n = std::min(size, writeChunkSize / 2);
+        std::memcpy(stage(n), in, n);
+        in += n;
+        size -= n;
+    }
+}
+
+unsigned char* OutputFile::stage(size_t size)
+{
+    if(_staged + size > writeChunkSize || _pending.size() >= IOV_MAX)
+        flush();
+
+    unsigned char* data = _staging->data() + _staged;
+    _staged += size;
+
+    if(!_direct)
+    {
+        // Consecutive staged bytes share one iovec.
+        if(!_pending.empty() && static_cast<const unsigned char*>(_pending.back().first) + _pending.back().second == data)
+            _pending.back().second += size;
+        else
+            _pending.push_back(std::make_pair(data, size));
+    }
+
+    return data;
+}
+
+void OutputFile::flush()
+{
+    if(_direct)
+    {
+        // Whole blocks go out; the rest waits for more data or close().
+        const size_t aligned = _staged / directAlignment * directAlignment;
+        writeAll(_fd, _staging->data(), aligned);
+        std::memmove(_staging->data(), _staging->data() + aligned, _staged - aligned);
+        _staged -= aligned;
+        return;
+    }
+
+    std::vector<iovec> iov(_pending.size());
+    for(size_t k = 0; k < _pending.size(); ++k)
+    {
+        iov[k].iov_base = const_cast<void*>(_pending[k].first);
+        iov[k].iov_len = _pending[k].second;
+    }
+    writevAll(_fd, iov);
+
+    _pending.clear();
+    _staged = 0;
+}
+
+void OutputFile::close()
+{
+    flush();
+
+#ifdef O_DIRECT
+    if(_direct && _staged > 0)
+    {
+        // The last partial block cannot be written with O_DIRECT.
+        fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_DIRECT);
+        writeAll(_fd, _staging->data(), _staged);
+        _staged = 0;
+    }
+#endif
+
+    const int fd = _fd;
+    _fd = -1;
+    if(::close(fd) != 0)
+        throw std::runtime_error(std::strerror(errno));
+}
+
+void StreamOutput::write(const void* data, size_t size)
+{
+    flush();
+    _out.write(static_cast<const char*>(data), size);
+}
+
+unsigned char* StreamOutput::stage(size_t size)
+{
+    if(_staged.size() + size > writeChunkSize)
+        flush();
+
+    _staged.resize(_staged.size() + size);
+    return _staged.data() + _staged.size() - size;
+}
+
+void StreamOutput::flush()
+{
+    _out.write(reinterpret_cast<const char*>(_staged.data()), _staged.size());
+    _staged.clear();
+}
+
+std::vector<char> readText(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::in|std::ios::binary|std::ios::ate);
+    if(!file)
+        throw std::runtime_error("cannot open " + filename);
+
+    std::vector<char> text(size_t(file.tellg()) + 1, '\0');
+    file.seekg(0, std::ios::beg);
+    file.read(text.data(), text.size() - 1);
+    return text;
+}
+
+std::vector<size_t> textChunks(const std::vector<char>& text, size_t chunkSize)
+{
+    const size_t size = text.size() - 1;
+    std::vector<size_t> bounds(1, 0);
+    while(bounds.back() < size)
+    {
+        // Move the nominal end of the chunk past the next line break.
+        const size_t nominal = std::min(size, bounds.back() + chunkSize);
+        const char* lineEnd = std::find(text.data() + nominal, text.data() + size, '\n');
+        bounds.push_back(std::min(size, size_t(lineEnd - text.data()) + 1));
+    }
+    return bounds;
+}
+
+std::vector<RowRead> matrixRows(size_t size, size_t itemSize, size_t nrCols,
+                                const Array<size_t>& rowIndices, ptrdiff_t rowIncrement)
+{
+    if(rowIncrement <= 0)
+        rowIncrement = nrCols;
+
+    std::vector<RowRead> rows;
+    if(rowIndices.data() == 0 || rowIndices.numElements() == 0)
+    {
+        for(size_t l = 0; l < size / rowIncrement; l++)
+            rows.push_back({l*rowIncrement*itemSize, l});
+    } else
+    {
+        size_t l = 0;
+        for(auto index : rowIndices)
+            rows.push_back({index*rowIncrement*itemSize, l++});
+    }
+
+    return rows;
+}
+
+// Rows go to out when it is given, otherwise to sink.
+static void readRows(const std::string& filename, unsigned char* out, const RowSink& sink,
+                     size_t rowBytes, std::vector<RowRead> rows, IoStats* stats)
+{
+    TimePoint start = tic();
+
+    std::sort(rows.begin(), rows.end(),
+        [](const RowRead& a, const RowRead& b){return a.offset < b.offset;});
+
+    // Split the sorted rows in groups [groups[k], groups[k+1]) read with
+    // one request each.
+    const size_t maxSize = out ? maxReadSize : convertChunkSize;
+    std::vector<size_t> groups(1, 0);
+    for(size_t k = 1; k < rows.size(); ++k)
+    {
+        const size_t first = rows[groups.back()].offset;
+        const size_t gap = rows[k].offset - std::min(rows[k].offset, rows[k-1].offset + rowBytes);
+        if(gap > maxReadGap || rows[k].offset + rowBytes - first > maxSize)
+            groups.push_back(k);
+    }
+    groups.push_back(rows.size());
+    const size_t numGroups = rows.empty() ? 0 : groups.size() - 1;
+
+    std::vector<size_t> groupBytes(numGroups);
+    InputFile file(filename);
+
+    auto readGroup = [&](size_t g)
+    {
+        const RowRead* begin = &rows[groups[g]];
+        const RowRead* end = begin + (groups[g+1] - groups[g]);
+        const size_t span = (end - 1)->offset + rowBytes - begin->offset;
+        groupBytes[g] = span;
+
+        // Consecutive rows going to consecutive destination rows are read
+        // in place.
+        bool direct = out != 0;
+        for(const RowRead* r = begin + 1; r != end && direct; ++r)
+            direct = r->offset == (r-1)->offset + rowBytes && r->row == (r-1)->row + 1;
+
+        if(direct)
+        {
+            readAt(file.fd(), out + begin->row * rowBytes, span, begin->offset);
+            return;
+        }
+
+        std::vector<unsigned char> buffer(span);
+        readAt(file.fd(), buffer.data(), span, begin->offset);
+        for(const RowRead* r = begin; r != end; ++r)
+        {
+            unsigned char* row = buffer.data() + (r->offset - begin->offset);
+            if(out)
+                std::memcpy(out + r->row * rowBytes, row, rowBytes);
+            else
+                sink(r->row, row);
+        }
+    };
+
+    // I/O threads wait on the disk, not the CPU, so they are not taken from
+    // the shared pool.
+    ThreadPool pool(std::min(ioThreads, std::max<size_t>(1, numGroups)) - 1);
+    pool.parallel_for(0, numGroups, [&](size_t begin, size_t end)
+    {
+        for(size_t g = begin; g < end; ++g)
+            readGroup(g);
+    });
+
+    if(stats)
+    {
+        stats->bytes = std::accumulate(groupBytes.begin(), groupBytes.end(), size_t(0));
+        stats->requests = numGroups;
+        stats->seconds = toc(start, false) * 1e-6;
+    }
+}
+
+void gatherRows(const std::string& filename, unsigned char* out, size_t rowBytes,
+                std::vector<RowRead> rows, IoStats* stats)
+{
+    readRows(filename, out, RowSink(), rowBytes, rows, stats);
+}
+
+void gatherRows(const std::string& filename, const RowSink& sink, size_t rowBytes,
+                std::vector<RowRead> rows, IoStats* stats)
+{
+    readRows(filename, 0, sink, rowBytes, rows, stats);
+}
+
+}
+
 }
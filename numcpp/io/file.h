@@ -4,7 +4,12 @@
 #include <fstream>
 #include <iostream>
 #include <string>
-#include "../base.h"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
 #include "../core.h"
 
 namespace numcpp
@@ -17,108 +22,685 @@ namespace numcpp
 @{
 */
 
+/// Statistics of a read: bytes moved from the file, number of read
+/// requests and elapsed time.
+struct IoStats
+{
+    size_t bytes;
+    size_t requests;
+    double seconds;
+
+    IoStats() : bytes(0), requests(0), seconds(0) {}
+
+    double megabytesPerSecond() const {return seconds > 0 ? bytes / seconds / 1e6 : 0;}
+};
+
 template<class T=double>
-Array<T> fromfile(std::string filename, long count=-1, std::string sep="")
+Array<T> fromfile(std::string filename, long count=-1)
 {
-  if(sep.empty())
+  std::ifstream file(filename, std::ios::in|std::ios::binary|std::ios::ate);
+  size_t size = count == -1 ? size_t(file.tellg()) / sizeof(T) : count;
+
+  Array<T> x = empty<T>({size});
+
+  file.seekg(0, std::ios::beg);
+  file.read((char*)x.data(), size*sizeof(T));
+  file.close();
+
+  return x;
+}
+
+template<class T=double>
+Array<T> fromfile(std::ifstream& file, long count)
+{
+  Array<T> x = empty<T>({size_t(count)});
+
+  file.read((char*)x.data(), count*sizeof(T));
+
+  return x;
+}
+
+size_t filesize(std::string filename);
+
+namespace detail
+{
+  // Reverse the bytes of every width-byte word of data.
+  void byteswap(void* data, size_t numBytes, size_t width);
+
+  // Bytes of the words to swap: complex numbers swap each part.
+  template<class T>
+  constexpr size_t wordWidth()
   {
-    std::ifstream file(filename, std::ios::in|std::ios::binary|std::ios::ate);
-    std::ifstream::pos_type sizebytes;
-    size_t size;
+    return sizeof(T) / (is_complex<T>::value ? 2 : 1);
+  }
+
+  // Reads that convert go through a buffer of this size, which stays in
+  // the L2 cache.
+  constexpr size_t convertChunkSize = 1 << 18;
 
-    if(count == -1)
+  // Convert n elements read from a file. Swapped data goes through a
+  // small block on the stack.
+  template<class Tdisk, class Tmem>
+  void convertFromDisk(Tmem* out, const Tdisk* in, size_t n, bool swapBytes)
+  {
+    if(!swapBytes)
     {
-      sizebytes = file.tellg();
-      size = sizebytes / sizeof(T);
-    } else
+      convert_n<CastMode::Truncate>(out, in, n);
+      return;
+    }
+
+    const size_t blockSize = 256;
+    Tdisk block[blockSize];
+    for(size_t done = 0; done < n; done += blockSize)
     {
-      sizebytes = count*sizeof(T);
-      size = count;
+      const size_t m = std::min(blockSize, n - done);
+      std::copy(in + done, in + done + m, block);
+      byteswap(block, m*sizeof(Tdisk), wordWidth<Tdisk>());
+      convert_n<CastMode::Truncate>(out + done, block, m);
     }
+  }
+}
 
-    Array<T> x(size);
+/// Read count elements stored as Tdisk into an Array<Tmem>, converting them
+/// chunk by chunk as they are read. Set swapBytes for data of the other
+/// byte order.
+template<class Tdisk, class Tmem>
+Array<Tmem> fromfile(std::ifstream& file, long count, bool swapBytes=false)
+{
+  Array<Tmem> x = empty<Tmem>({size_t(count)});
+
+  std::vector<Tdisk> buffer(std::min(size_t(count), detail::convertChunkSize / sizeof(Tdisk)));
+  for(size_t done = 0; done < size_t(count); done += buffer.size())
+  {
+    const size_t n = std::min(buffer.size(), size_t(count) - done);
+    file.read((char*)buffer.data(), n*sizeof(Tdisk));
+    detail::convertFromDisk(x.data() + done, buffer.data(), n, swapBytes);
+  }
+
+  return x;
+}
 
-    file.seekg (0, std::ios::beg);
-    file.read ((char*)x.data(), sizebytes);
-    file.close();
+template<class Tdisk, class Tmem>
+Array<Tmem> fromfile(std::string filename, long count=-1, bool swapBytes=false)
+{
+  std::ifstream file(filename, std::ios::in|std::ios::binary|std::ios::ate);
+  if(count == -1)
+    count = size_t(file.tellg()) / sizeof(Tdisk);
+
+  file.seekg(0, std::ios::beg);
+  return fromfile<Tdisk, Tmem>(file, count, swapBytes);
+}
 
-    return x;
+/// How tofile writes a binary file.
+///  - Buffered: through the page cache.
+///  - Direct: with O_DIRECT where the file system supports it, so that
+///    dumps much larger than memory do not evict the page cache.
+enum class WriteMode {Buffered, Direct};
+
+namespace detail
+{
+  // Views are gathered and written in chunks of this size.
+  constexpr size_t writeChunkSize = 1 << 22;
+
+  // Write-only POSIX file. Large contiguous runs are written in place with
+  // writev; the rest is gathered into an aligned staging buffer. In direct
+  // mode everything goes through the staging buffer, written in aligned
+  // blocks.
+  class OutputFile
+  {
+  public:
+    OutputFile(const std::string& filename, bool direct);
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+
+    // Write size bytes, which must stay valid until the next flush.
+    void write(const void* data, size_t size);
+
+    // Space for the next size bytes of the file, size <= writeChunkSize / 2.
+    unsigned char* stage(size_t size);
+
+    void flush();
+
+    // Write everything and close the file, throwing on errors.
+    void close();
+
+  private:
+    int _fd;
+    bool _direct;
+    Manager::Ptr _staging;
+    size_t _staged;
+    std::vector<std::pair<const void*, size_t> > _pending;
+  };
+
+  // The same interface over a std::ostream.
+  class StreamOutput
+  {
+  public:
+    explicit StreamOutput(std::ostream& out) : _out(out) {}
+
+    void write(const void* data, size_t size);
+    unsigned char* stage(size_t size);
+    void flush();
+
+  private:
+    std::ostream& _out;
+    std::vector<unsigned char> _staged;
+  };
+
+  // Send the elements of x in C order to out. Rows with unit stride are
+  // written from the array itself; other rows are gathered chunk by chunk.
+  template<class T, class Output>
+  void writeArray(Output& out, const Array<T>& x)
+  {
+    if(x.isContiguous())
+    {
+      out.write(firstByte(x), x.numElements()*sizeof(T));
+      out.flush();
+      return;
+    }
+
+    const int ndims = x.ndims();
+    const size_t chunk = writeChunkSize / 2 / sizeof(T);
+    if(ndims > maxViewDims)
+    {
+      // Too many dimensions for the row loop: gather through the iterator.
+      const size_t n = x.numElements();
+      auto it = x.begin();
+      for(size_t done = 0; done < n; done += chunk)
+      {
+        const size_t m = std::min(chunk, n - done);
+        T* staged = reinterpret_cast<T*>(out.stage(m*sizeof(T)));
+        for(size_t j = 0; j < m; ++j, ++it)
+          staged[j] = *it;
+      }
+      out.flush();
+      return;
+    }
+
+    const std::ptrdiff_t stride = x.strides()[ndims-1];
+    strided_for_each_row<1>(ndims, x.shape().data(), {{firstByte(x)}}, {{x.strides().data()}},
+      [&](const std::array<unsigned char*, 1>& p, size_t n)
+      {
+        if(stride == sizeof(T))
+        {
+          out.write(p[0], n*sizeof(T));
+          return;
+        }
+
+        for(size_t done = 0; done < n; done += chunk)
+        {
+          const size_t m = std::min(chunk, n - done);
+          T* staged = reinterpret_cast<T*>(out.stage(m*sizeof(T)));
+          const unsigned char* in = p[0] + done*stride;
+          for(size_t j = 0; j < m; ++j, in += stride)
+            staged[j] = *reinterpret_cast<const T*>(in);
+        }
+      });
+    out.flush();
   }
 }
 
-template<class T=double>
-Array<T> fromfile(std::ifstream& file, long count)
+namespace detail
 {
-  std::ifstream::pos_type sizebytes;
-  size_t size;
+  // Conversion of values to and from text. Floating point values get
+  // enough digits to be read back exactly.
+  template<class T, class Enable=void>
+  struct TextValue;
 
-  sizebytes = count*sizeof(T);
-  size = count;
+  // Room for the text of one value.
+  constexpr size_t textValueSize = 64;
 
-  Array<T> x(size);
+  template<class T>
+  struct TextValue<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+  {
+    static size_t format(char* out, T value)
+    {
+      typedef typename std::make_unsigned<T>::type U;
+      const bool negative = std::is_signed<T>::value && value < T(0);
+      U u = negative ? U(U(0) - U(value)) : U(value);
+
+      char digits[24];
+      size_t n = 0;
+      do
+      {
+        digits[n++] = char('0' + u % 10);
+        u /= 10;
+      } while(u != 0);
+
+      size_t length = 0;
+      if(negative)
+        out[length++] = '-';
+      while(n > 0)
+        out[length++] = digits[--n];
+      return length;
+    }
+
+    static T parse(const char* p, char** end)
+    {
+      return std::is_signed<T>::value ? T(std::strtoll(p, end, 10)) : T(std::strtoull(p, end, 10));
+    }
+  };
 
-  file.read ((char*)x.data(), sizebytes);
+  template<>
+  struct TextValue<bool>
+  {
+    static size_t format(char* out, bool value)
+    {
+      out[0] = value ? '1' : '0';
+      return 1;
+    }
 
-  return x;
+    static bool parse(const char* p, char** end)
+    {
+      return std::strtol(p, end, 10) != 0;
+    }
+  };
+
+  inline float parseReal(const char* p, char** end, float) {return std::strtof(p, end);}
+  inline double parseReal(const char* p, char** end, double) {return std::strtod(p, end);}
+  inline long double parseReal(const char* p, char** end, long double) {return std::strtold(p, end);}
+
+  template<class T>
+  struct TextValue<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+  {
+    static size_t format(char* out, T value)
+    {
+      const int digits = std::numeric_limits<T>::max_digits10;
+      if(sizeof(T) > sizeof(double))
+        return std::snprintf(out, textValueSize, "%.*Lg", digits, (long double)value);
+      return std::snprintf(out, textValueSize, "%.*g", digits, double(value));
+    }
+
+    static T parse(const char* p, char** end)
+    {
+      return parseReal(p, end, T());
+    }
+  };
+
+  // Half floats go through float.
+  template<class F>
+  struct TextValue<HalfFloat<F> >
+  {
+    static size_t format(char* out, HalfFloat<F> value)
+    {
+      return TextValue<float>::format(out, value);
+    }
+
+    static HalfFloat<F> parse(const char* p, char** end)
+    {
+      return HalfFloat<F>(std::strtof(p, end));
+    }
+  };
+
+  // Text is formatted in parallel in blocks of about textBlockValues
+  // values, textBlocksInFlight blocks at a time, and written in order.
+  constexpr size_t textBlockValues = 1 << 14;
+  constexpr size_t textBlocksInFlight = 64;
+
+  // Write rows x cols values, each row followed by newline and the values
+  // of a row separated by delimiter. Row i starts at rowData(i) and its
+  // values are colStride bytes apart.
+  template<class T, class RowData>
+  void writeText(const std::string& filename, RowData rowData, size_t rows, size_t cols,
+                 std::ptrdiff_t colStride, const std::string& delimiter, const std::string& newline)
+  {
+    std::ofstream file(filename, std::ios::out|std::ios::binary|std::ios::trunc);
+    if(!file)
+      throw std::runtime_error("cannot open " + filename);
+
+    const size_t rowsPerBlock = std::max<size_t>(1, textBlockValues / std::max<size_t>(1, cols));
+    const size_t numBlocks = ceil_div(rows, rowsPerBlock);
+    std::vector<std::string> text(std::min(numBlocks, textBlocksInFlight));
+
+    for(size_t first = 0; first < numBlocks; first += textBlocksInFlight)
+    {
+      const size_t last = std::min(numBlocks, first + textBlocksInFlight);
+      parallel_for(first, last, [&](size_t begin, size_t end)
+      {
+        char value[textValueSize];
+        for(size_t b = begin; b < end; ++b)
+        {
+          std::string& out = text[b - first];
+          out.clear();
+          for(size_t i = b*rowsPerBlock; i < std::min(rows, (b+1)*rowsPerBlock); ++i)
+          {
+            const unsigned char* row = rowData(i);
+            for(size_t j = 0; j < cols; ++j)
+            {
+              const T& v = *reinterpret_cast<const T*>(row + j*colStride);
+              out.append(value, TextValue<T>::format(value, v));
+              out += j+1 < cols ? delimiter : newline;
+            }
+          }
+        }
+      });
+
+      for(size_t b = first; b < last; ++b)
+        file.write(text[b - first].data(), text[b - first].size());
+    }
+
+    if(!file)
+      throw std::runtime_error("cannot write " + filename);
+  }
 }
 
-size_t filesize(std::string filename);
+/// Write x in C order to a raw binary file, or as text with separator sep.
+/// Views are written without copying the whole array first.
+template<class T>
+void tofile(const Array<T>& x, std::string filename, WriteMode mode)
+{
+  detail::OutputFile file(filename, mode == WriteMode::Direct);
+  detail::writeArray(file, x);
+  file.close();
+}
 
 template<class T>
-void tofile(Array<T> x, std::string filename, std::string sep="")
+void tofile(const Array<T>& x, std::string filename, std::string sep="")
 {
   if(sep.empty())
   {
-    std::ofstream file(filename, std::ios::out|std::ios::binary|std::ios::trunc);
-    file.write((char*) x.data(), x.size()*sizeof(T));
-    file.close();
+    tofile(x, filename, WriteMode::Buffered);
   } else
   {
-    std::ofstream file(filename, std::ios::out|std::ios::trunc);
-    for(size_t i=0; i< x.size(); i++)
-      file << x[i] << sep;
-    file.close();
+    // Every value is followed by sep. The rows along the last axis are
+    // found from their index, so views are written in place.
+    const int inner = x.ndims() - 1;
+    const size_t cols = x.ndims() > 0 ? x.shape()[inner] : 1;
+    const size_t rows = cols > 0 ? x.numElements() / cols : 0;
+    const unsigned char* first = detail::firstByte(x);
+    const Shape& shape = x.shape();
+    const Strides& strides = x.strides();
+    auto rowData = [&](size_t i)
+    {
+      const unsigned char* row = first;
+      for(int d = inner - 1; d >= 0; --d)
+      {
+        row += std::ptrdiff_t(i % shape[d]) * strides[d];
+        i /= shape[d];
+      }
+      return row;
+    };
+    detail::writeText<T>(filename, rowData, rows, cols, inner >= 0 ? strides[inner] : 0, sep, sep);
   }
 }
 
-inline void tofile(DynTypeArray& x, std::ofstream& file)
+template<class T>
+void tofile(const Array<T>& x, std::ofstream& file)
+{
+  detail::StreamOutput out(file);
+  detail::writeArray(out, x);
+}
+
+namespace detail
 {
-   file.write((char*) x.data(), x.size()*x.elemSize());
+  // Read-only POSIX file descriptor, closed on destruction.
+  class InputFile
+  {
+  public:
+    explicit InputFile(const std::string& filename);
+    ~InputFile();
+
+    InputFile(const InputFile&) = delete;
+
+    int fd() const {return _fd;}
+
+  private:
+    int _fd;
+  };
+
+  // Read exactly size bytes at offset, retrying short reads.
+  void readAt(int fd, void* data, size_t size, size_t offset);
+
+  // Rows separated by less than maxReadGap bytes in the file are fetched
+  // with a single request and the gap is discarded; requests are not made
+  // larger than maxReadSize. Requests are issued from ioThreads threads.
+  constexpr size_t maxReadGap = 1 << 16;
+  constexpr size_t maxReadSize = 1 << 24;
+  constexpr size_t ioThreads = 4;
+
+  struct RowRead
+  {
+    size_t offset;   // in the file
+    size_t row;      // in the destination
+  };
+
+  // Copy rows of rowBytes bytes from the file to the destination rows of
+  // out, coalescing nearby rows into large preads.
+  void gatherRows(const std::string& filename, unsigned char* out, size_t rowBytes,
+                  std::vector<RowRead> rows, IoStats* stats);
+
+  // Receives each row read by gatherRows with its destination row.
+  typedef std::function<void(size_t row, const unsigned char* data)> RowSink;
+
+  // As above, but handing the rows to sink. The reads are not made larger
+  // than convertChunkSize, so that the rows are still in cache.
+  void gatherRows(const std::string& filename, const RowSink& sink, size_t rowBytes,
+                  std::vector<RowRead> rows, IoStats* stats);
+
+  // Whether loadMatrix reads the whole file as it is.
+  inline bool wholeMatrix(const Array<size_t>& rowIndices, ptrdiff_t rowIncrement)
+  {
+    // A default constructed Array has no data and means every row.
+    const bool allRows = rowIndices.data() == 0 || rowIndices.numElements() == 0;
+    return allRows && rowIncrement <= 0;
+  }
+
+  // File offsets of the rows read by loadMatrix from a file of size
+  // elements of itemSize bytes.
+  std::vector<RowRead> matrixRows(size_t size, size_t itemSize, size_t nrCols,
+                                  const Array<size_t>& rowIndices, ptrdiff_t rowIncrement);
 }
 
+/// Read the rows rowIndices of a matrix of nrCols columns stored in C order
+/// in filename. Rows start every rowIncrement elements (nrCols by default).
+/// Without row indices, every row is read. Scattered rows are sorted and
+/// merged into large reads issued in parallel; pass stats to get the
+/// achieved throughput.
 template<class T>
 Array<T> loadMatrix(std::string filename, size_t nrCols, Array<size_t> rowIndices=Array<size_t>(),
-                    ptrdiff_t rowIncrement=-1)
+                    ptrdiff_t rowIncrement=-1, IoStats* stats=0)
+{
+  size_t size = filesize(filename) / sizeof(T);
+
+  if(detail::wholeMatrix(rowIndices, rowIncrement))
+  {
+    size_t nrRows = size / nrCols;
+    return reshape(fromfile<T>(filename, nrRows*nrCols), {nrRows, nrCols});
+  }
+
+  std::vector<detail::RowRead> rows = detail::matrixRows(size, sizeof(T), nrCols, rowIndices, rowIncrement);
+
+  Array<T> matrix = empty<T>({rows.size(), nrCols});
+  detail::gatherRows(filename, reinterpret_cast<unsigned char*>(matrix.data()),
+                     nrCols*sizeof(T), rows, stats);
+
+  return matrix;
+}
+
+/// loadMatrix for a file of Tdisk elements, converted to Tmem as the rows
+/// are read. Set swapBytes for data of the other byte order.
+template<class Tdisk, class Tmem>
+Array<Tmem> loadMatrix(std::string filename, size_t nrCols, Array<size_t> rowIndices=Array<size_t>(),
+                       ptrdiff_t rowIncrement=-1, IoStats* stats=0, bool swapBytes=false)
 {
-  size_t sizeBytes = filesize(filename);
-  size_t size = sizeBytes / sizeof(T);
+  size_t size = filesize(filename) / sizeof(Tdisk);
 
-  if(rowIndices.size() == 0 && rowIncrement <= 0)
+  if(detail::wholeMatrix(rowIndices, rowIncrement))
   {
     size_t nrRows = size / nrCols;
-    return reshape(fromfile<T>(filename, size), nrRows,nrCols);
-  } else {
+    return reshape(fromfile<Tdisk, Tmem>(filename, nrRows*nrCols, swapBytes), {nrRows, nrCols});
+  }
+
+  std::vector<detail::RowRead> rows = detail::matrixRows(size, sizeof(Tdisk), nrCols, rowIndices, rowIncrement);
+
+  Array<Tmem> matrix = empty<Tmem>({rows.size(), nrCols});
+  Tmem* out = matrix.data();
+  detail::gatherRows(filename, [=](size_t row, const unsigned char* data)
+  {
+    detail::convertFromDisk(out + row*nrCols, reinterpret_cast<const Tdisk*>(data), nrCols, swapBytes);
+  }, nrCols*sizeof(Tdisk), rows, stats);
 
-    if(rowIndices.size() == 0)
-      rowIndices = range(0, size / rowIncrement);
-    if(rowIncrement <= 0)
-      rowIncrement = nrCols;
+  return matrix;
+}
 
-    auto nrRows = rowIndices.size();
+namespace detail
+{
+  // Text files are parsed in parallel in chunks of about this size.
+  constexpr size_t textChunkSize = 1 << 20;
 
-    Array<T> matrix = zeros(nrRows, nrCols);
+  // Contents of a text file followed by a null character.
+  std::vector<char> readText(const std::string& filename);
 
-    std::ifstream file(filename, std::ios::in|std::ios::binary|std::ios::ate);
+  // Offsets splitting text, without its final null, into chunks of whole
+  // lines of about chunkSize bytes.
+  std::vector<size_t> textChunks(const std::vector<char>& text, size_t chunkSize);
 
-    for(size_t l=0; l< nrRows;l++)
+  template<class T>
+  struct TextChunk
+  {
+    TextChunk() : rows(0), cols(0) {}
+
+    std::vector<T> values;
+    size_t rows;
+    size_t cols;
+  };
+
+  // Parse the lines of [begin, end), where end is after a line break or at
+  // the end of the text. With a whitespace delimiter, values are separated
+  // by any run of whitespace; otherwise by exactly one delimiter, with
+  // optional whitespace around it, so that empty fields are errors.
+  template<class T>
+  void parseText(const char* begin, const char* end, char delimiter, TextChunk<T>& chunk)
+  {
+    auto blank = [](char c)
     {
-      file.seekg(rowIndices(l)*rowIncrement*sizeof(T), std::ios::beg);
-      file.read( (char*)(matrix.data()+nrCols*l), nrCols*sizeof(T));
+      return c == ' ' || c == '\t' || c == '\r';
+    };
+    auto lineEnd = [end](const char* p)
+    {
+      return p == end || *p == '\n' || *p == '#';
+    };
+    const bool whitespace = blank(delimiter);
+
+    // Throw for the token starting at p.
+    auto fail = [&](const char* p)
+    {
+      const char* tokenEnd = std::find_if(p, end, [&](char c){return blank(c) || c == delimiter || c == '\n';});
+      if(tokenEnd == p)
+        throw std::runtime_error("loadtxt: empty field");
+      throw std::runtime_error("loadtxt: cannot parse '" + std::string(p, tokenEnd) + "'");
+    };
+
+    const char* p = begin;
+    while(p < end)
+    {
+      size_t cols = 0;
+      while(p < end && blank(*p))
+        ++p;
+
+      while(!lineEnd(p))
+      {
+        // A value ends at a separator or at the end of the line.
+        const char* token = p;
+        char* next = const_cast<char*>(p);
+        if(*p != delimiter)
+          chunk.values.push_back(TextValue<T>::parse(p, &next));
+        p = next;
+        if(p == token || !(lineEnd(p) || blank(*p) || *p == delimiter))
+          fail(token);
+        ++cols;
+
+        while(p < end && blank(*p))
+          ++p;
+        if(lineEnd(p) || whitespace)
+          continue;
+
+        if(*p != delimiter)
+          fail(p);
+        ++p;
+        while(p < end && blank(*p))
+          ++p;
+        if(lineEnd(p))
+          throw std::runtime_error("loadtxt: empty field");
+      }
+
+      // Skip the comment, if any, and the line break.
+      p = std::find(p, end, '\n');
+      if(p < end)
+        ++p;
+
+      if(cols == 0)
+        continue;
+      if(chunk.rows == 0)
+        chunk.cols = cols;
+      else if(cols != chunk.cols)
+        throw std::runtime_error("loadtxt: the rows have different numbers of values");
+      ++chunk.rows;
     }
-    file.close();
+  }
+}
+
+/// Write a 1-D or 2-D array as text, as numpy.savetxt: one row per line,
+/// with the values separated by delimiter. Rows are formatted in parallel
+/// and written in large blocks.
+template<class T>
+void savetxt(const std::string& filename, const Array<T>& x, char delimiter=' ')
+{
+  if(x.ndims() == 0 || x.ndims() > 2)
+    throw std::invalid_argument("savetxt: the array must be 1-D or 2-D");
+
+  const size_t rows = x.shape()[0];
+  const size_t cols = x.ndims() == 2 ? x.shape()[1] : 1;
+  const std::ptrdiff_t colStride = x.ndims() == 2 ? x.strides()[1] : 0;
+  const unsigned char* first = detail::firstByte(x);
+  const std::ptrdiff_t rowStride = x.strides()[0];
+  detail::writeText<T>(filename, [=](size_t i){return first + std::ptrdiff_t(i) * rowStride;},
+                       rows, cols, colStride, std::string(1, delimiter), "\n");
+}
 
-    return matrix;
+/// Read a text file of rows of values into a 2-D array, as numpy.loadtxt.
+/// Values are separated by whitespace, or by exactly one delimiter when it
+/// is not a space, in which case empty fields are errors; empty lines and
+/// comments starting with '#' are skipped. The file is parsed in parallel
+/// chunks of whole lines.
+template<class T>
+Array<T> loadtxt(const std::string& filename, char delimiter=' ')
+{
+  const std::vector<char> text = detail::readText(filename);
+  const std::vector<size_t> bounds = detail::textChunks(text, detail::textChunkSize);
+  const size_t numChunks = bounds.size() - 1;
+
+  std::vector<detail::TextChunk<T> > chunks(numChunks);
+  parallel_for(0, numChunks, [&](size_t begin, size_t end)
+  {
+    for(size_t c = begin; c < end; ++c)
+      detail::parseText(text.data() + bounds[c], text.data() + bounds[c+1], delimiter, chunks[c]);
+  });
+
+  size_t rows = 0;
+  size_t cols = 0;
+  std::vector<size_t> offsets(numChunks);
+  for(size_t c = 0; c < numChunks; ++c)
+  {
+    offsets[c] = rows * cols;
+    if(chunks[c].rows == 0)
+      continue;
+    if(rows > 0 && chunks[c].cols != cols)
+      throw std::runtime_error("loadtxt: the rows have different numbers of values");
+    cols = chunks[c].cols;
+    rows += chunks[c].rows;
   }
+
+  Array<T> x = empty<T>({rows, cols});
+  T* out = x.data();
+  parallel_for(0, numChunks, [&](size_t begin, size_t end)
+  {
+    for(size_t c = begin; c < end; ++c)
+      std::copy(chunks[c].values.begin(), chunks[c].values.end(), out + offsets[c]);
+  });
+
+  return x;
 }
 
 /*
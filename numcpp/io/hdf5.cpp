@@ -1,120 +1,525 @@
 #include "hdf5.h"
 #include "../core.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+
 namespace numcpp
 {
 
-hid_t hdf5_mem_type_id(Type t)
+hid_t h5create(std::string filename, unsigned flags,
+               hid_t create_plist, hid_t access_plist )
+{
+  // HDF5 cannot truncate a file that is open.
+  detail::H5HandleCache::instance().release(filename);
+  hid_t file = H5Fcreate(filename.c_str(), flags, create_plist, access_plist);
+  return file;
+}
+
+hid_t h5open(std::string filename, unsigned flags, hid_t access_plist )
+{
+  detail::H5HandleCache::instance().release(filename);
+  hid_t file = H5Fopen(filename.c_str(), flags, access_plist);
+  return file;
+}
+
+void h5close(hid_t file)
+{
+    H5Fclose(file);
+}
+
+namespace detail
 {
-  switch(t)
+
+hid_t h5integerType(size_t size, bool isSigned)
+{
+  switch(size)
   {
-    case Type::Int:
-      return H5T_NATIVE_INT;
-    case Type::Double:
-      return H5T_NATIVE_DOUBLE;
-    case Type::Float:
-      return H5T_NATIVE_FLOAT;
-    default:
-      throw std::invalid_argument("Type not supported!");
+  case 1:
+    return isSigned ? H5T_NATIVE_INT8 : H5T_NATIVE_UINT8;
+  case 2:
+    return isSigned ? H5T_NATIVE_INT16 : H5T_NATIVE_UINT16;
+  case 4:
+    return isSigned ? H5T_NATIVE_INT32 : H5T_NATIVE_UINT32;
+  case 8:
+    return isSigned ? H5T_NATIVE_INT64 : H5T_NATIVE_UINT64;
   }
+  throw std::invalid_argument("hdf5: unsupported integer size");
 }
 
-Type dtype(hid_t t)
+hid_t h5halfType(size_t exponentBits, size_t mantissaBits)
 {
-  if(H5Tequal(t,H5T_NATIVE_INT))
-      return Type::Int;
-  if(H5Tequal(t,H5T_NATIVE_DOUBLE))
-        return Type::Double;
-  if(H5Tequal(t,H5T_NATIVE_FLOAT))
-        return Type::Float;
+  // Sign bit on top, then the exponent and the mantissa, in native order.
+  hid_t type = H5Tcopy(H5T_NATIVE_FLOAT);
+  H5Tset_fields(type, 15, mantissaBits, exponentBits, 0, mantissaBits);
+  H5Tset_size(type, 2);
+  H5Tset_ebias(type, (size_t(1) << (exponentBits - 1)) - 1);
+  return type;
+}
 
-  std::stringstream s;
-  s << "dtype(hid_t t): Type not supported, t = " << t << " !";
-  throw std::invalid_argument(s.str());
+hid_t h5complexType(hid_t partType, size_t partSize)
+{
+  hid_t type = H5Tcreate(H5T_COMPOUND, 2 * partSize);
+  H5Tinsert(type, "r", 0, partType);
+  H5Tinsert(type, "i", partSize, partType);
+  return type;
 }
 
+hid_t h5boolType()
+{
+  static_assert(sizeof(bool) == 1, "hdf5: bool is stored as int8");
+  hid_t type = H5Tenum_create(H5T_NATIVE_INT8);
+  const int8_t no = 0, yes = 1;
+  H5Tenum_insert(type, "FALSE", &no);
+  H5Tenum_insert(type, "TRUE", &yes);
+  return type;
+}
 
-hid_t h5create(std::string filename, unsigned flags,
-               hid_t create_plist, hid_t access_plist )
+H5Id::H5Id(hid_t id, herr_t (*close)(hid_t), const std::string& what)
+  : _id(id), _close(close)
 {
-  hid_t file = H5Fcreate(filename.c_str(), flags, create_plist, access_plist);
-  return file;
+  if(_id < 0)
+    throw std::runtime_error("hdf5: cannot open " + what);
 }
 
-hid_t h5open(std::string filename, unsigned flags, hid_t access_plist )
+H5Id::~H5Id()
 {
-  hid_t file = H5Fopen(filename.c_str(), flags, access_plist);
-  return file;
+  _close(_id);
 }
 
-void h5close(hid_t file)
+Shape selectHyperslab(hid_t space, const std::vector<Index>& index)
 {
-    H5Fclose(file);
+  const int rank = H5Sget_simple_extent_ndims(space);
+  std::vector<hsize_t> dims(rank);
+  H5Sget_simple_extent_dims(space, dims.data(), NULL);
+
+  std::vector<hsize_t> start(rank, 0), stride(rank, 1), count(dims);
+  Shape shape;
+
+  int d = 0;
+  for(auto& idx : index)
+  {
+    if(idx.isNewAxis())
+    {
+      shape.push_back(1);
+      continue;
+    }
+
+    if(d == rank)
+      throw std::invalid_argument("h5read: the index has more elements than dataset dimensions");
+
+    // Dimensions may not fit in an int.
+    const std::ptrdiff_t size = dims[d];
+    if(idx.isSingleton())
+    {
+      const std::ptrdiff_t i = idx.index(size);
+      if(i < 0 || i >= size)
+        throw std::invalid_argument("h5read: index out of range");
+      start[d] = i;
+      count[d] = 1;
+    }
+    else
+    {
+      const Slice& slice = idx.slice();
+      if(slice.step() <= 0)
+        throw std::invalid_argument("h5read: hyperslabs need positive steps");
+
+      const std::ptrdiff_t begin = slice.start(size);
+      start[d] = begin;
+      stride[d] = slice.step();
+      count[d] = std::max<std::ptrdiff_t>(0, ceil_div<std::ptrdiff_t>(slice.end(size) - begin, slice.step()));
+      shape.push_back(count[d]);
+    }
+    ++d;
+  }
+
+  for(; d < rank; ++d)
+    shape.push_back(dims[d]);
+
+  if(rank == 0)
+    return shape;
+
+  if(std::find(count.begin(), count.end(), hsize_t(0)) != count.end())
+    H5Sselect_none(space);
+  else
+    H5Sselect_hyperslab(space, H5S_SELECT_SET, start.data(), stride.data(), count.data(), NULL);
+
+  return shape;
 }
 
-void h5write(const DynTypeArray& x, std::string filename, std::string location)
+Shape h5selectionShape(hid_t dataset, const std::vector<Index>& index)
 {
-  hid_t file = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-  //hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  H5Id space(H5Dget_space(dataset), H5Sclose, "dataspace");
+  return selectHyperslab(space, index);
+}
+
+hid_t memorySpace(const Shape& shape, const Strides& strides, size_t itemSize)
+{
+  // Dimensions of one element do not change the order of the elements.
+  std::vector<hsize_t> count;
+  std::vector<std::ptrdiff_t> step;
+  for(size_t i = 0; i < shape.size(); ++i)
+  {
+    if(shape[i] == 1)
+      continue;
+    if(strides[i] <= 0 || strides[i] % std::ptrdiff_t(itemSize) != 0)
+      return -1;
+    count.push_back(shape[i]);
+    step.push_back(strides[i] / itemSize);
+  }
+
+  if(count.empty())
+  {
+    hsize_t one = 1;
+    return H5Screate_simple(1, &one, NULL);
+  }
+
+  // The array is a hyperslab of a C-ordered block whose dimensions come
+  // from the strides: the innermost dimension spans the stride of the one
+  // before it, and so on outwards.
+  const size_t m = count.size();
+  std::vector<hsize_t> dims(m), stride(m, 1), start(m, 0);
+  stride[m-1] = step[m-1];
+  for(size_t i = m-1; i > 0; --i)
+  {
+    if(i < m-1 && step[i-1] % step[i] != 0)
+      return -1;
+    dims[i] = step[i-1] / (i == m-1 ? 1 : step[i]);
+  }
+  dims[0] = (count[0] - 1) * stride[0] + 1;
 
-  h5write(x, file, location);
+  for(size_t i = 0; i < m; ++i)
+    if((count[i] - 1) * stride[i] + 1 > dims[i])
+      return -1;
 
-  H5Fclose(file);
+  hid_t space = H5Screate_simple(m, dims.data(), NULL);
+  H5Sselect_hyperslab(space, H5S_SELECT_SET, start.data(), stride.data(), count.data(), NULL);
+  return space;
 }
 
-void h5write(const DynTypeArray& x, hid_t file, std::string location)
+// Dataspace of dataset with index selected, checked to have the given
+// shape.
+static hid_t selectInDataset(hid_t dataset, const std::vector<Index>& index, const Shape& shape)
 {
-  hid_t dataset, dataspace;
-  hsize_t dimsf[x.ndims()];
-  herr_t status;
+  hid_t space = H5Dget_space(dataset);
+  if(selectHyperslab(space, index) != shape)
+  {
+    H5Sclose(space);
+    throw std::invalid_argument("hdf5: the selection and the array have different shapes");
+  }
+  return space;
+}
 
-  /* write response */
-  std::copy(x.shape().begin(), x.shape().end(), dimsf);
+bool h5readSelection(hid_t dataset, const std::vector<Index>& index,
+                     hid_t type, const Shape& shape, const Strides& strides, size_t itemSize,
+                     unsigned char* data)
+{
+  const hid_t memory = memorySpace(shape, strides, itemSize);
+  if(memory < 0)
+    return false;
+  H5Id memSpace(memory, H5Sclose, "memory space");
+
+  H5Id fileSpace(selectInDataset(dataset, index, shape), H5Sclose, "dataspace");
 
-  dataspace = H5Screate_simple(x.ndims(), dimsf, NULL);
-  dataset = H5Dcreate(file, location.c_str(), hdf5_mem_type_id(x.elemType()),
-                      dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if(prod(shape) > 0 && H5Dread(dataset, type, memSpace, fileSpace, H5P_DEFAULT, data) < 0)
+    throw std::runtime_error("h5read: cannot read the dataset");
+  return true;
+}
+
+bool h5writeSelection(hid_t dataset, const std::vector<Index>& index,
+                      hid_t type, const Shape& shape, const Strides& strides, size_t itemSize,
+                      const unsigned char* data)
+{
+  const hid_t memory = memorySpace(shape, strides, itemSize);
+  if(memory < 0)
+    return false;
+  H5Id memSpace(memory, H5Sclose, "memory space");
 
-  status = H5Dwrite(dataset, hdf5_mem_type_id(x.elemType()), H5S_ALL, H5S_ALL, H5P_DEFAULT, x.data() );
+  H5Id fileSpace(selectInDataset(dataset, index, shape), H5Sclose, "dataspace");
 
-  H5Sclose(dataspace);
-  H5Dclose(dataset);
+  if(prod(shape) > 0 && H5Dwrite(dataset, type, memSpace, fileSpace, H5P_DEFAULT, data) < 0)
+    throw std::runtime_error("h5write: cannot write the dataset");
+  return true;
 }
 
-DynTypeArray h5readDynType(std::string filename, std::string location)
+// Raw-data chunk cache set by h5set_chunk_cache; 0 for the default.
+static std::atomic<size_t> chunkCacheBytes(0);
+
+// Number of chunk slots of the cache. HDF5 recommends a prime about a
+// hundred times the number of chunks that fit in the cache.
+static const size_t chunkCacheSlots = 12421;
+
+// Dataset access property list with a chunk cache of the given size.
+static hid_t datasetAccess(size_t cacheBytes)
 {
-  hid_t dataset, dataspace, type;
-  std::vector<size_t> shape;
-  herr_t status;
-  int rank;
+  hid_t access = H5Pcreate(H5P_DATASET_ACCESS);
+  if(cacheBytes > 0)
+    H5Pset_chunk_cache(access, chunkCacheSlots, cacheBytes, H5D_CHUNK_CACHE_W0_DEFAULT);
+  return access;
+}
 
-  hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+Shape h5chunkShape(const Shape& shape, size_t itemSize, int accessAxis)
+{
+  Shape chunks(shape);
+  for(auto& c : chunks)
+    c = std::max<size_t>(c, 1);
+  if(accessAxis >= 0 && accessAxis < int(chunks.size()))
+    chunks[accessAxis] = 1;
 
-  dataset = H5Dopen(file, location.c_str(), H5P_DEFAULT);
-  if( dataset < 0 )
-    throw std::exception();
+  // Halve the largest dimension until the chunk is small enough.
+  while(prod(chunks) * itemSize > h5chunkBytes)
+  {
+    auto largest = std::max_element(chunks.begin(), chunks.end());
+    *largest = ceil_div<size_t>(*largest, 2);
+  }
 
-  type = H5Dget_type(dataset);
-  dataspace = H5Dget_space(dataset);
-  rank      = H5Sget_simple_extent_ndims(dataspace);
-  hsize_t dimsf[rank];
-  status    = H5Sget_simple_extent_dims(dataspace, dimsf, NULL);
+  return chunks;
+}
 
-  shape.resize(rank);
+hid_t h5openDataset(hid_t file, const std::string& location)
+{
+  H5Id access(datasetAccess(chunkCacheBytes), H5Pclose, "access properties");
+  return H5Dopen(file, location.c_str(), access);
+}
 
-  for(int i=0; i<rank; i++)
-    shape[i] = dimsf[i];
+hid_t h5createDataset(hid_t file, const std::string& location, hid_t type, const Shape& shape,
+                      const H5Storage& storage)
+{
+  std::vector<hsize_t> dims(shape.begin(), shape.end());
+  H5Id space(H5Screate_simple(dims.size(), dims.data(), NULL), H5Sclose, location);
+  H5Id create(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "creation properties");
 
-  Type t = dtype(type);
-  DynTypeArray x(t, nbytes(t), shape);
+  const bool chunked = storage.chunked || !storage.chunks.empty() || storage.deflate > 0 || storage.shuffle;
+  if(chunked && !shape.empty() && prod(shape) > 0)
+  {
+    const Shape chunks = storage.chunks.empty() ? h5chunkShape(shape, H5Tget_size(type), storage.accessAxis)
+                                                : storage.chunks;
+    if(chunks.size() != shape.size())
+      throw std::invalid_argument("h5write: the chunks and the array have different dimensions");
+
+    std::vector<hsize_t> chunkDims(chunks.begin(), chunks.end());
+    H5Pset_chunk(create, chunkDims.size(), chunkDims.data());
 
-  status = H5Dread(dataset, hdf5_mem_type_id(x.elemType()), H5S_ALL, H5S_ALL, H5P_DEFAULT, x.data() );
+    // The shuffle filter goes before deflate.
+    if(storage.shuffle)
+      H5Pset_shuffle(create);
+    if(storage.deflate > 0)
+    {
+      if(!H5Zfilter_avail(H5Z_FILTER_DEFLATE))
+        throw std::runtime_error("h5write: the HDF5 library has no deflate filter");
+      H5Pset_deflate(create, storage.deflate);
+    }
+  }
 
-  H5Sclose(dataspace);
-  H5Dclose(dataset);
-  H5Fclose(file);
+  H5Id access(datasetAccess(storage.chunkCache > 0 ? storage.chunkCache : size_t(chunkCacheBytes)),
+              H5Pclose, "access properties");
+  hid_t dataset = H5Dcreate(file, location.c_str(), type, space, H5P_DEFAULT, create, access);
+  if(dataset < 0)
+    throw std::runtime_error("h5write: cannot create " + location);
+  return dataset;
+}
 
-  return x;
+// Key of filename in the handle cache: its canonical path when it exists.
+static std::string fileKey(const std::string& filename)
+{
+  char* path = realpath(filename.c_str(), NULL);
+  if(!path)
+    return filename;
+
+  std::string key(path);
+  free(path);
+  return key;
+}
+
+static std::string datasetKey(const std::string& file, const std::string& location)
+{
+  return file + '\0' + location;
+}
+
+H5HandleCache& H5HandleCache::instance()
+{
+  // Initializing HDF5 first makes the cache close its handles before the
+  // library shuts down at exit.
+  H5open();
+  static H5HandleCache cache;
+  return cache;
+}
+
+H5HandleCache::H5HandleCache()
+  : _capacity(64)
+{}
+
+H5HandleCache::~H5HandleCache()
+{
+  closeAll();
+}
+
+hid_t H5HandleCache::lookup(const std::string& key, bool writable)
+{
+  auto it = _entries.find(key);
+  if(it == _entries.end())
+    return -1;
+
+  if(writable && !it->second.writable)
+  {
+    close(key);
+    return -1;
+  }
+
+  _recent.splice(_recent.begin(), _recent, it->second.position);
+  return it->second.id;
+}
+
+void H5HandleCache::insert(const std::string& key, hid_t id, bool writable, const std::string& file)
+{
+  _recent.push_front(key);
+  _entries[key] = Entry{id, writable, file, _recent.begin()};
+
+  while(_entries.size() > _capacity)
+    close(_recent.back());
+}
+
+void H5HandleCache::close(std::string key)
+{
+  auto it = _entries.find(key);
+  if(it == _entries.end())
+    return;
+
+  const Entry entry = it->second;
+  if(entry.file.empty())
+  {
+    // The datasets of a file go first.
+    std::vector<std::string> datasets;
+    for(auto& e : _entries)
+      if(e.second.file == key)
+        datasets.push_back(e.first);
+    for(auto& d : datasets)
+      close(d);
+
+    H5Fclose(entry.id);
+  }
+  else
+    H5Dclose(entry.id);
+
+  _recent.erase(entry.position);
+  _entries.erase(key);
+}
+
+hid_t H5HandleCache::file(const std::string& filename, bool writable)
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+  const std::string key = fileKey(filename);
+  hid_t id = lookup(key, writable);
+  if(id >= 0)
+    return id;
+
+  if(writable && !std::ifstream(filename))
+  {
+    id = H5Fcreate(filename.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+    if(id < 0)
+      throw std::runtime_error("hdf5: cannot create " + filename);
+    insert(fileKey(filename), id, true, "");
+    return id;
+  }
+
+  id = H5Fopen(filename.c_str(), writable ? H5F_ACC_RDWR : H5F_ACC_RDONLY, H5P_DEFAULT);
+  if(id < 0)
+    throw std::runtime_error("hdf5: cannot open " + filename);
+  insert(key, id, writable, "");
+  return id;
+}
+
+hid_t H5HandleCache::dataset(const std::string& filename, const std::string& location, bool writable)
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+  const hid_t fileId = file(filename, writable);
+  const std::string file = fileKey(filename);
+  const std::string key = datasetKey(file, location);
+  hid_t id = lookup(key, writable);
+  if(id >= 0)
+    return id;
+
+  id = h5openDataset(fileId, location);
+  if(id < 0)
+    throw std::runtime_error("hdf5: cannot open " + location + " in " + filename);
+  insert(key, id, writable, file);
+  return id;
+}
+
+hid_t H5HandleCache::createDataset(const std::string& filename, const std::string& location, hid_t type,
+                                   const Shape& shape, const H5Storage& storage)
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+  const hid_t fileId = file(filename, true);
+  const std::string file = fileKey(filename);
+  const std::string key = datasetKey(file, location);
+
+  close(key);
+  if(H5Lexists(fileId, location.c_str(), H5P_DEFAULT) > 0)
+    H5Ldelete(fileId, location.c_str(), H5P_DEFAULT);
+
+  const hid_t id = h5createDataset(fileId, location, type, shape, storage);
+  insert(key, id, true, file);
+  return id;
+}
+
+void H5HandleCache::release(const std::string& filename)
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  close(fileKey(filename));
+}
+
+void H5HandleCache::closeAll()
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  while(!_recent.empty())
+    close(_recent.back());
+}
+
+void H5HandleCache::flush()
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  for(auto& e : _entries)
+    if(e.second.file.empty() && e.second.writable)
+      H5Fflush(e.second.id, H5F_SCOPE_LOCAL);
+}
+
+void H5HandleCache::setCapacity(size_t handles)
+{
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+  // A dataset and its file are open together.
+  _capacity = std::max<size_t>(handles, 2);
+  while(_entries.size() > _capacity)
+    close(_recent.back());
+}
+
+}
+
+void h5set_chunk_cache(size_t bytes)
+{
+  // Cached datasets are reopened with the new cache.
+  detail::H5HandleCache::instance().closeAll();
+  detail::chunkCacheBytes = bytes;
+}
+
+void h5flush()
+{
+  detail::H5HandleCache::instance().flush();
+}
+
+void h5close_all()
+{
+  detail::H5HandleCache::instance().closeAll();
+}
+
+void h5set_cache_size(size_t handles)
+{
+  detail::H5HandleCache::instance().setCapacity(handles);
 }
 
 }
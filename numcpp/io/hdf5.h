@@ -2,6 +2,12 @@
 #define NUMCPP_HDF5_H
 
 #include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <mutex>
+#include <complex>
+#include <type_traits>
 //#include <fstream>
 //#include <iostream>
 #include <hdf5.h>
@@ -45,26 +51,319 @@ An example of the usage can be found \ref example03 "here".
 */
 void h5close(hid_t file);
 
+namespace detail
+{
+  // Predefined HDF5 integer type of the given size in bytes.
+  hid_t h5integerType(size_t size, bool isSigned);
+
+  // IEEE floating point type with the bit layout of HalfFloat<Format>.
+  hid_t h5halfType(size_t exponentBits, size_t mantissaBits);
+
+  // Compound type of two members "r" and "i" of the given type, as h5py
+  // stores complex numbers.
+  hid_t h5complexType(hid_t partType, size_t partSize);
+
+  // Enum of int8 with the members FALSE and TRUE, as h5py stores bool.
+  hid_t h5boolType();
+
+  // HDF5 memory type of the elements of Array<T>. The types that are not
+  // predefined are created on first use and live until the library closes.
+  // When the type of a dataset differs, HDF5 converts the elements while
+  // reading or writing.
+  template<class T, class Enable=void>
+  struct H5Type;
+
+  template<class T>
+  struct H5Type<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+  {
+    static hid_t id() {return h5integerType(sizeof(T), std::is_signed<T>::value);}
+  };
+
+  template<>
+  struct H5Type<bool>
+  {
+    static hid_t id()
+    {
+      static const hid_t type = h5boolType();
+      return type;
+    }
+  };
+
+  template<>
+  struct H5Type<float>
+  {
+    static hid_t id() {return H5T_NATIVE_FLOAT;}
+  };
+
+  template<>
+  struct H5Type<double>
+  {
+    static hid_t id() {return H5T_NATIVE_DOUBLE;}
+  };
+
+  template<>
+  struct H5Type<long double>
+  {
+    static hid_t id() {return H5T_NATIVE_LDOUBLE;}
+  };
+
+  template<>
+  struct H5Type<float16>
+  {
+    static hid_t id()
+    {
+      static const hid_t type = h5halfType(5, 10);
+      return type;
+    }
+  };
+
+  template<>
+  struct H5Type<bfloat16>
+  {
+    static hid_t id()
+    {
+      static const hid_t type = h5halfType(8, 7);
+      return type;
+    }
+  };
+
+  template<class T>
+  struct H5Type<std::complex<T> >
+  {
+    static hid_t id()
+    {
+      static const hid_t type = h5complexType(H5Type<T>::id(), sizeof(T));
+      return type;
+    }
+  };
+
+  // HDF5 identifier closed on destruction with the matching H5*close.
+  class H5Id
+  {
+  public:
+    H5Id(hid_t id, herr_t (*close)(hid_t), const std::string& what);
+    ~H5Id();
+
+    H5Id(const H5Id&) = delete;
+
+    operator hid_t() const {return _id;}
+
+  private:
+    hid_t _id;
+    herr_t (*_close)(hid_t);
+  };
+
+  // Select index in the dataspace of a dataset, as operator[] does on
+  // arrays, and return the shape of the selection: integers drop their
+  // dimension and newaxis adds one. Steps must be positive.
+  Shape selectHyperslab(hid_t space, const std::vector<Index>& index);
+
+  // Shape of the selection index of dataset.
+  Shape h5selectionShape(hid_t dataset, const std::vector<Index>& index);
+
+  // Memory dataspace for the elements of an array of the given shape and
+  // byte strides, relative to its first element, or -1 when HDF5 cannot
+  // describe the layout (negative, unaligned or interleaved strides).
+  hid_t memorySpace(const Shape& shape, const Strides& strides, size_t itemSize);
+
+  // Read the selection index of dataset into the array at data, or write
+  // the array to it. Both return false, without doing anything, when the
+  // layout of the array has no memory dataspace.
+  bool h5readSelection(hid_t dataset, const std::vector<Index>& index,
+                       hid_t type, const Shape& shape, const Strides& strides, size_t itemSize,
+                       unsigned char* data);
+  bool h5writeSelection(hid_t dataset, const std::vector<Index>& index,
+                        hid_t type, const Shape& shape, const Strides& strides, size_t itemSize,
+                        const unsigned char* data);
+
+  template<class T>
+  void h5readDataset(const Array<T>& out, hid_t dataset, const std::vector<Index>& index)
+  {
+    if(h5readSelection(dataset, index, H5Type<T>::id(), out.shape(), out.strides(), sizeof(T), firstByte(out)))
+      return;
+
+    Array<T> buffer = empty<T>(out.shape());
+    h5readSelection(dataset, index, H5Type<T>::id(), buffer.shape(), buffer.strides(), sizeof(T), firstByte(buffer));
+    Array<T>(out).deep() = buffer;
+  }
+
+  template<class T>
+  void h5writeDataset(const Array<T>& x, hid_t dataset, const std::vector<Index>& index)
+  {
+    if(h5writeSelection(dataset, index, H5Type<T>::id(), x.shape(), x.strides(), sizeof(T), firstByte(x)))
+      return;
+
+    Array<T> buffer = copy(x);
+    h5writeSelection(dataset, index, H5Type<T>::id(), buffer.shape(), buffer.strides(), sizeof(T), firstByte(buffer));
+  }
+}
+
 /*!
-Write the array \a x into the hdf5 file \a filename at location \a location.
-An example of the usage can be found \ref example03 "here".
-\sa h5read()
+Storage of the datasets created by h5write. By default datasets are
+contiguous and uncompressed.
+
+Chunked storage is used when \a chunked is set, when \a chunks is given or
+when a filter is enabled. Without \a chunks, chunks of about 1 MiB are
+chosen from the shape of the array; a chunk holds a single index along
+\a accessAxis, so that reading one frame along that axis only touches the
+chunks of that frame (-1 for no preferred axis). \a deflate is the gzip
+level (0 to 9, 0 for none) and \a shuffle reorders the bytes of the
+elements before compression, which usually helps deflate on numeric data.
+\a chunkCache is the size in bytes of the raw-data chunk cache used while
+writing (0 for the size set by h5set_chunk_cache()).
 */
-void h5write(const DynTypeArray& x, std::string filename, std::string location);
+struct H5Storage
+{
+  H5Storage() : chunked(false), accessAxis(0), deflate(0), shuffle(false), chunkCache(0) {}
+
+  bool chunked;
+  Shape chunks;
+  int accessAxis;
+  int deflate;
+  bool shuffle;
+  size_t chunkCache;
+};
 
 /*!
-Write the array \a x into the hdf5 file \a file at location \a location.
-An example of the usage can be found \ref example03 "here".
+Set the size in bytes of the raw-data chunk cache of the datasets opened
+from now on (0 restores the HDF5 default of 1 MiB). Chunked datasets
+read in pieces that do not line up with their chunks need a cache that
+holds the chunks of a whole read.
+*/
+void h5set_chunk_cache(size_t bytes);
+
+namespace detail
+{
+  // Chunks are made about this size when chosen automatically.
+  constexpr size_t h5chunkBytes = 1 << 20;
+
+  // Automatic chunk shape for a dataset of the given shape.
+  Shape h5chunkShape(const Shape& shape, size_t itemSize, int accessAxis);
+
+  // Open dataset location with the chunk cache set by h5set_chunk_cache.
+  hid_t h5openDataset(hid_t file, const std::string& location);
+
+  // Create dataset location with the given shape, element type and storage.
+  hid_t h5createDataset(hid_t file, const std::string& location, hid_t type, const Shape& shape,
+                        const H5Storage& storage);
+
+  // Files and datasets opened by name, kept open in least recently used
+  // order. Callers hold lock() while they use the returned handles, which
+  // stay owned by the cache. The lock also serializes the calls to HDF5,
+  // whose default build is not thread-safe.
+  class H5HandleCache
+  {
+  public:
+    static H5HandleCache& instance();
+
+    std::unique_lock<std::recursive_mutex> lock() {return std::unique_lock<std::recursive_mutex>(_mutex);}
+
+    // Open filename, read-only or writable. A writable file is created if
+    // it does not exist; a read-only handle is reopened when writing.
+    hid_t file(const std::string& filename, bool writable);
+
+    hid_t dataset(const std::string& filename, const std::string& location, bool writable);
+
+    // Create dataset location, replacing any dataset already there.
+    hid_t createDataset(const std::string& filename, const std::string& location, hid_t type,
+                        const Shape& shape, const H5Storage& storage);
+
+    // Close the handles of filename, of every file.
+    void release(const std::string& filename);
+    void closeAll();
+
+    void flush();
+    void setCapacity(size_t handles);
+
+  private:
+    H5HandleCache();
+    ~H5HandleCache();
+
+    struct Entry
+    {
+      hid_t id;
+      bool writable;
+      std::string file;   // key of the file, for datasets
+      std::list<std::string>::iterator position;
+    };
+
+    hid_t lookup(const std::string& key, bool writable);
+    void insert(const std::string& key, hid_t id, bool writable, const std::string& file);
+    void close(std::string key);
+
+    std::recursive_mutex _mutex;
+    std::map<std::string, Entry> _entries;
+    std::list<std::string> _recent;
+    size_t _capacity;
+  };
+}
+
+/*!
+Write the pending changes of the files kept open by h5read and h5write to
+disk. Files and datasets opened by name stay open between calls, so that
+loading many datasets of a file opens it once.
+\sa h5close_all()
+*/
+void h5flush();
+
+/*!
+Close the files and datasets kept open by h5read and h5write.
+\sa h5flush()
+*/
+void h5close_all();
+
+/*!
+Set the number of file and dataset handles kept open by h5read and h5write
+(64 by default). The least recently used handles are closed first.
+*/
+void h5set_cache_size(size_t handles);
+
+/*!
+Read the hyperslab \a index of the dataset \a location of \a file into the
+existing array \a out, which may be a strided view. The shape of the
+selection must be the shape of \a out. Views whose strides HDF5 can describe
+are filled in place; others go through a temporary array.
 \sa h5read()
 */
-void h5write(const DynTypeArray& x, hid_t file, std::string location);
+template<class T>
+void h5read_into(const Array<T>& out, hid_t file, std::string location,
+                 const std::vector<Index>& index=std::vector<Index>())
+{
+  detail::H5Id dataset(detail::h5openDataset(file, location), H5Dclose, location);
+  detail::h5readDataset(out, dataset, index);
+}
+
+template<class T>
+void h5read_into(const Array<T>& out, std::string filename, std::string location,
+                 const std::vector<Index>& index=std::vector<Index>())
+{
+  detail::H5HandleCache& cache = detail::H5HandleCache::instance();
+  auto lock = cache.lock();
+  detail::h5readDataset(out, cache.dataset(filename, location, false), index);
+}
 
 /*!
-Read an array from the hdf5 file \a filename located at \a location.
+Read the hyperslab \a index (the whole dataset by default) of the dataset
+\a location of \a file. Only the selected elements are read from the file:
+\code
+Array<double> frame = h5read<double>(file, "/data", {k});
+Array<double> roi = h5read<double>(file, "/data", {k, Slice(100,200), Slice(0,none,2)});
+\endcode
+T can be any integer type, bool, float16, bfloat16, float, double, long
+double or a complex type. When the dataset stores another type, HDF5
+converts the elements as it reads them. Complex numbers are compound types
+with the members "r" and "i" and bools are enums, as in h5py.
 An example of the usage can be found \ref example03 "here".
 \sa h5write()
 */
-DynTypeArray h5readDynType(std::string filename, std::string location);
+template<class T>
+Array<T> h5read(hid_t file, std::string location, const std::vector<Index>& index=std::vector<Index>())
+{
+  detail::H5Id dataset(detail::h5openDataset(file, location), H5Dclose, location);
+  Array<T> x = empty<T>(detail::h5selectionShape(dataset, index));
+  detail::h5readDataset(x, dataset, index);
+  return x;
+}
 
 /*!
 Read an array from the hdf5 file \a filename located at \a location.
@@ -72,12 +371,66 @@ An example of the usage can be found \ref example03 "here".
 \sa h5write()
 */
 template<class T>
-Array<T> h5read(std::string filename, std::string location)
+Array<T> h5read(std::string filename, std::string location, const std::vector<Index>& index=std::vector<Index>())
+{
+  detail::H5HandleCache& cache = detail::H5HandleCache::instance();
+  auto lock = cache.lock();
+  const hid_t dataset = cache.dataset(filename, location, false);
+  Array<T> x = empty<T>(detail::h5selectionShape(dataset, index));
+  detail::h5readDataset(x, dataset, index);
+  return x;
+}
+
+/*!
+Write \a x into the hyperslab \a index of the existing dataset \a location
+of \a file. The shape of the selection must be the shape of \a x, which may
+be a strided view.
+\sa h5read()
+*/
+template<class T>
+void h5write(const Array<T>& x, hid_t file, std::string location, const std::vector<Index>& index)
 {
-  return (Array<T>)(h5readDynType(filename,location));
+  detail::H5Id dataset(detail::h5openDataset(file, location), H5Dclose, location);
+  detail::h5writeDataset(x, dataset, index);
 }
 
+template<class T>
+void h5write(const Array<T>& x, std::string filename, std::string location, const std::vector<Index>& index)
+{
+  detail::H5HandleCache& cache = detail::H5HandleCache::instance();
+  auto lock = cache.lock();
+  detail::h5writeDataset(x, cache.dataset(filename, location, true), index);
+}
 
+/*!
+Write the array \a x into the hdf5 file \a file at location \a location,
+creating a dataset with the given \a storage.
+An example of the usage can be found \ref example03 "here".
+\sa h5read()
+*/
+template<class T>
+void h5write(const Array<T>& x, hid_t file, std::string location, const H5Storage& storage=H5Storage())
+{
+  detail::H5Id dataset(detail::h5createDataset(file, location, detail::H5Type<T>::id(), x.shape(), storage),
+                       H5Dclose, location);
+  detail::h5writeDataset(x, dataset, std::vector<Index>());
+}
+
+/*!
+Write the array \a x into the hdf5 file \a filename at location \a location.
+The file is created if needed; other datasets in it are kept, and a dataset
+already at \a location is replaced.
+An example of the usage can be found \ref example03 "here".
+\sa h5read()
+*/
+template<class T>
+void h5write(const Array<T>& x, std::string filename, std::string location, const H5Storage& storage=H5Storage())
+{
+  detail::H5HandleCache& cache = detail::H5HandleCache::instance();
+  auto lock = cache.lock();
+  const hid_t dataset = cache.createDataset(filename, location, detail::H5Type<T>::id(), x.shape(), storage);
+  detail::h5writeDataset(x, dataset, std::vector<Index>());
+}
 
 /*! @} */
 
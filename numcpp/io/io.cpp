@@ -1,3 +1,4 @@
 
 #include "file.cpp"
 #include "hdf5.cpp"
+#include "npy.cpp"
@@ -0,0 +1,415 @@
+#include "npy.h"
+
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace numcpp
+{
+
+namespace
+{
+    const char npyMagic[] = "\x93NUMPY";
+    const size_t npyMagicSize = 6;
+    const size_t npyAlignment = 64;
+
+    // Text of the value of key in the header dictionary: a quoted string,
+    // a tuple, or a bare word.
+    std::string dictValue(const std::string& dict, const std::string& key)
+    {
+        size_t pos = dict.find("'" + key + "'");
+        if(pos == std::string::npos)
+            throw std::runtime_error("npy: missing " + key + " in header");
+
+        pos = dict.find_first_not_of(" ", dict.find(':', pos) + 1);
+        size_t end;
+        if(dict[pos] == '(')
+            end = dict.find(')', pos) + 1;
+        else if(dict[pos] == '\'' || dict[pos] == '"')
+            end = dict.find(dict[pos], pos + 1) + 1;
+        else
+            end = dict.find_first_of(",}", pos);
+
+        if(end == std::string::npos || end == 0)
+            throw std::runtime_error("npy: malformed header");
+
+        return dict.substr(pos, end - pos);
+    }
+
+    void putLittleEndian(std::string& out, std::uint64_t value, int numBytes)
+    {
+        for(int i = 0; i < numBytes; ++i)
+            out.push_back(char((value >> (8 * i)) & 0xff));
+    }
+
+    std::uint64_t getLittleEndian(const unsigned char* in, int numBytes)
+    {
+        std::uint64_t value = 0;
+        for(int i = numBytes - 1; i >= 0; --i)
+            value = (value << 8) | in[i];
+        return value;
+    }
+
+    std::vector<std::uint32_t> crcTable()
+    {
+        std::vector<std::uint32_t> table(256);
+        for(std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for(int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }
+
+    std::uint32_t crc32(std::uint32_t crc, const unsigned char* data, size_t numBytes)
+    {
+        static const std::vector<std::uint32_t> table = crcTable();
+
+        crc = ~crc;
+        for(size_t i = 0; i < numBytes; ++i)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    // Zip records used by .npz files. Only stored (uncompressed) entries
+    // without zip64 extensions are supported.
+    const std::uint32_t zipLocalSignature = 0x04034b50;
+    const std::uint32_t zipCentralSignature = 0x02014b50;
+    const std::uint32_t zipEndSignature = 0x06054b50;
+    const size_t zipLocalHeaderSize = 30;
+    const size_t zipCentralHeaderSize = 46;
+    const size_t zipEndSize = 22;
+
+    std::string zipLocalHeader(const std::string& name, std::uint32_t crc, size_t size)
+    {
+        std::string header;
+        putLittleEndian(header, zipLocalSignature, 4);
+        putLittleEndian(header, 20, 2);         // version needed
+        putLittleEndian(header, 0, 2);          // flags
+        putLittleEndian(header, 0, 2);          // stored
+        putLittleEndian(header, 0, 2);          // time
+        putLittleEndian(header, 0x21, 2);       // date: 1980-01-01
+        putLittleEndian(header, crc, 4);
+        putLittleEndian(header, size, 4);
+        putLittleEndian(header, size, 4);
+        putLittleEndian(header, name.size(), 2);
+        putLittleEndian(header, 0, 2);
+        return header + name;
+    }
+
+    struct ZipEntry
+    {
+        std::string name;
+        std::uint32_t method;
+        size_t localOffset;
+    };
+
+    std::vector<ZipEntry> readZipDirectory(std::istream& in)
+    {
+        in.seekg(0, std::ios::end);
+        const size_t fileSize = in.tellg();
+        if(!in || fileSize < zipEndSize)
+            throw std::runtime_error("npz: not a zip file");
+
+        const size_t tailSize = std::min<size_t>(fileSize, zipEndSize + 0xffff);
+
+        std::vector<unsigned char> tail(tailSize);
+        in.seekg(fileSize - tailSize);
+        if(!in.read(reinterpret_cast<char*>(tail.data()), tailSize))
+            throw std::runtime_error("npz: cannot read the end of the zip file");
+
+        size_t end = std::string::npos;
+        for(size_t i = tailSize - zipEndSize + 1; i-- > 0;)
+            if(getLittleEndian(&tail[i], 4) == zipEndSignature)
+            {
+                end = i;
+                break;
+            }
+        if(end == std::string::npos)
+            throw std::runtime_error("npz: not a zip file");
+
+        const size_t numEntries = getLittleEndian(&tail[end + 10], 2);
+        const size_t directorySize = getLittleEndian(&tail[end + 12], 4);
+        const size_t directoryOffset = getLittleEndian(&tail[end + 16], 4);
+
+        std::vector<unsigned char> directory(directorySize);
+        in.seekg(directoryOffset);
+        in.read(reinterpret_cast<char*>(directory.data()), directorySize);
+        if(!in)
+            throw std::runtime_error("npz: truncated zip directory");
+
+        std::vector<ZipEntry> entries;
+        size_t pos = 0;
+        for(size_t k = 0; k < numEntries; ++k)
+        {
+            if(pos + zipCentralHeaderSize > directorySize
+                || getLittleEndian(&directory[pos], 4) != zipCentralSignature)
+                throw std::runtime_error("npz: corrupt zip directory");
+
+            const unsigned char* h = &directory[pos];
+            const size_t nameSize = getLittleEndian(h + 28, 2);
+            const size_t extraSize = getLittleEndian(h + 30, 2);
+            const size_t commentSize = getLittleEndian(h + 32, 2);
+
+            ZipEntry entry;
+            entry.method = getLittleEndian(h + 10, 2);
+            entry.localOffset = getLittleEndian(h + 42, 4);
+            entry.name.assign(reinterpret_cast<const char*>(h + zipCentralHeaderSize), nameSize);
+            entries.push_back(entry);
+
+            pos += zipCentralHeaderSize + nameSize + extraSize + commentSize;
+        }
+
+        return entries;
+    }
+}
+
+NpyHeader readNpyHeader(std::istream& in)
+{
+    unsigned char prefix[npyMagicSize + 2];
+    if(!in.read(reinterpret_cast<char*>(prefix), sizeof(prefix))
+        || std::memcmp(prefix, npyMagic, npyMagicSize) != 0)
+        throw std::runtime_error("npy: not a .npy file");
+
+    const int major = prefix[npyMagicSize];
+    const int lengthBytes = major == 1 ? 2 : 4;
+    unsigned char length[4];
+    if(!in.read(reinterpret_cast<char*>(length), lengthBytes))
+        throw std::runtime_error("npy: truncated header");
+
+    std::string dict(getLittleEndian(length, lengthBytes), '\0');
+    if(!in.read(&dict[0], dict.size()))
+        throw std::runtime_error("npy: truncated header");
+
+    NpyHeader header;
+
+    std::string descr = dictValue(dict, "descr");
+    if(descr.size() < 2 || (descr[0] != '\'' && descr[0] != '"'))
+        throw std::runtime_error("npy: structured dtypes are not supported");
+    header.descr = descr.substr(1, descr.size() - 2);
+
+    header.fortranOrder = dictValue(dict, "fortran_order") == "True";
+
+    std::string shape = dictValue(dict, "shape");
+    std::replace(shape.begin(), shape.end(), '(', ' ');
+    std::replace(shape.begin(), shape.end(), ')', ' ');
+    std::replace(shape.begin(), shape.end(), ',', ' ');
+    std::istringstream dims(shape);
+    size_t dim;
+    while(dims >> dim)
+        header.shape.push_back(dim);
+
+    return header;
+}
+
+std::string npyHeader(const NpyHeader& header)
+{
+    std::string dict = "{'descr': '" + header.descr + "', 'fortran_order': "
+        + (header.fortranOrder ? "True" : "False") + ", 'shape': (";
+    for(size_t i = 0; i < header.shape.size(); ++i)
+        dict += (i > 0 ? ", " : "") + std::to_string(header.shape[i]);
+    if(header.shape.size() == 1)
+        dict += ",";
+    dict += "), }";
+
+    // Version 1.0 has a 2-byte header length, 2.0 a 4-byte one.
+    const int lengthBytes = dict.size() + npyAlignment > 0xffff ? 4 : 2;
+    const size_t prefixSize = npyMagicSize + 2 + lengthBytes;
+    const size_t total = (prefixSize + dict.size() + 1 + npyAlignment - 1) / npyAlignment * npyAlignment;
+    dict.append(total - prefixSize - dict.size() - 1, ' ');
+    dict += '\n';
+
+    std::string result(npyMagic, npyMagicSize);
+    result += char(lengthBytes == 2 ? 1 : 2);
+    result += char(0);
+    putLittleEndian(result, dict.size(), lengthBytes);
+    return result + dict;
+}
+
+std::vector<std::string> npz_keys(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::in|std::ios::binary);
+    if(!file)
+        throw std::runtime_error("cannot open " + filename);
+
+    std::vector<std::string> keys;
+    for(auto& entry : readZipDirectory(file))
+    {
+        std::string name = entry.name;
+        if(name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+            name.erase(name.size() - 4);
+        keys.push_back(name);
+    }
+    return keys;
+}
+
+namespace detail
+{
+    char nativeByteOrder()
+    {
+        const std::uint16_t one = 1;
+        return *reinterpret_cast<const unsigned char*>(&one) == 1 ? '<' : '>';
+    }
+
+    MappedFile::MappedFile(const std::string& filename, size_t offset, size_t size, MapMode mode)
+        : _data(0)
+    {
+        const int fd = open(filename.c_str(), mode == MapMode::Shared ? O_RDWR : O_RDONLY);
+        if(fd < 0)
+            throw std::runtime_error("cannot open " + filename);
+
+        // Pages past the end of the file raise SIGBUS when touched.
+        struct stat info;
+        if(fstat(fd, &info) != 0 || size_t(info.st_size) < offset + size)
+        {
+            close(fd);
+            throw std::runtime_error("npy: unexpected end of file in " + filename);
+        }
+
+        // Mappings start on a page boundary.
+        const size_t page = sysconf(_SC_PAGESIZE);
+        const size_t start = offset / page * page;
+        const size_t length = size + offset - start;
+
+        void* base = length == 0 ? 0 : mmap(0, length, PROT_READ | PROT_WRITE,
+            mode == MapMode::Shared ? MAP_SHARED : MAP_PRIVATE, fd, start);
+        close(fd);
+        if(base == MAP_FAILED)
+            throw std::runtime_error("cannot map " + filename);
+
+        _mapping.reset(base, [length](void* p){if(p) munmap(p, length);});
+        _data = static_cast<unsigned char*>(base) + (offset - start);
+    }
+
+    void NpyStream::write(const void* data, size_t numBytes)
+    {
+        if(!_out.write(static_cast<const char*>(data), numBytes))
+            throw std::runtime_error("npy: write failed");
+
+        _crc = crc32(_crc, static_cast<const unsigned char*>(data), numBytes);
+        _size += numBytes;
+    }
+
+    size_t npzEntryOffset(std::istream& in, const std::string& name)
+    {
+        for(auto& entry : readZipDirectory(in))
+        {
+            if(entry.name != name + ".npy" && entry.name != name)
+                continue;
+
+            if(entry.method != 0)
+                throw std::runtime_error("npz: compressed entries are not supported");
+
+            unsigned char header[zipLocalHeaderSize];
+            in.seekg(entry.localOffset);
+            if(!in.read(reinterpret_cast<char*>(header), zipLocalHeaderSize)
+                || getLittleEndian(header, 4) != zipLocalSignature)
+                throw std::runtime_error("npz: corrupt zip entry " + entry.name);
+
+            return entry.localOffset + zipLocalHeaderSize
+                + getLittleEndian(header + 26, 2) + getLittleEndian(header + 28, 2);
+        }
+
+        throw std::invalid_argument("npz: no array named " + name);
+    }
+}
+
+NpzWriter::NpzWriter(const std::string& filename)
+    : _file(filename, std::ios::out|std::ios::binary|std::ios::trunc), _closed(false)
+{
+    if(!_file)
+        throw std::runtime_error("cannot open " + filename);
+}
+
+NpzWriter::~NpzWriter()
+{
+    if(!_closed)
+    {
+        try
+        {
+            close();
+        }
+        catch(...)
+        {}
+    }
+}
+
+size_t NpzWriter::beginEntry(const std::string& name)
+{
+    if(_closed)
+        throw std::runtime_error("npz: the file is already closed");
+
+    const size_t offset = _file.tellp();
+    _entries.push_back({name + ".npy", offset, 0, 0});
+    const std::string header = zipLocalHeader(name + ".npy", 0, 0);
+    _file.write(header.data(), header.size());
+    return offset;
+}
+
+void NpzWriter::endEntry(size_t offset, std::uint32_t crc, size_t size)
+{
+    if(size > 0xffffffffu || offset > 0xffffffffu)
+        throw std::runtime_error("npz: entries past 4 GiB are not supported");
+
+    Entry& entry = _entries.back();
+    entry.crc = crc;
+    entry.size = size;
+
+    // Patch the CRC and sizes now that they are known.
+    const size_t end = _file.tellp();
+    const std::string header = zipLocalHeader(entry.name, crc, size);
+    _file.seekp(offset);
+    _file.write(header.data(), header.size());
+    _file.seekp(end);
+}
+
+void NpzWriter::close()
+{
+    _closed = true;
+
+    const size_t directoryOffset = _file.tellp();
+    std::string directory;
+    for(auto& entry : _entries)
+    {
+        putLittleEndian(directory, zipCentralSignature, 4);
+        putLittleEndian(directory, 20, 2);      // version made by
+        putLittleEndian(directory, 20, 2);      // version needed
+        putLittleEndian(directory, 0, 2);       // flags
+        putLittleEndian(directory, 0, 2);       // stored
+        putLittleEndian(directory, 0, 2);       // time
+        putLittleEndian(directory, 0x21, 2);    // date
+        putLittleEndian(directory, entry.crc, 4);
+        putLittleEndian(directory, entry.size, 4);
+        putLittleEndian(directory, entry.size, 4);
+        putLittleEndian(directory, entry.name.size(), 2);
+        putLittleEndian(directory, 0, 2);       // extra
+        putLittleEndian(directory, 0, 2);       // comment
+        putLittleEndian(directory, 0, 2);       // disk
+        putLittleEndian(directory, 0, 2);       // internal attributes
+        putLittleEndian(directory, 0, 4);       // external attributes
+        putLittleEndian(directory, entry.offset, 4);
+        directory += entry.name;
+    }
+
+    const size_t directorySize = directory.size();
+    putLittleEndian(directory, zipEndSignature, 4);
+    putLittleEndian(directory, 0, 2);
+    putLittleEndian(directory, 0, 2);
+    putLittleEndian(directory, _entries.size(), 2);
+    putLittleEndian(directory, _entries.size(), 2);
+    putLittleEndian(directory, directorySize, 4);
+    putLittleEndian(directory, directoryOffset, 4);
+    putLittleEndian(directory, 0, 2);
+
+    _file.write(directory.data(), directory.size());
+    _file.close();
+    if(!_file)
+        throw std::runtime_error("npz: write failed");
+}
+
+}
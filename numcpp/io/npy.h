@@ -0,0 +1,301 @@
+#ifndef NUMCPP_NPY_H
+#define NUMCPP_NPY_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <complex>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "../core.h"
+#include "file.h"
+
+namespace numcpp
+{
+
+/*!
+@file
+
+@addtogroup io
+@{
+*/
+
+/// How load_npy and load_npz get the data of the file.
+///  - None: read it into a new, cache-line aligned array.
+///  - Private: map the file copy-on-write; writes to the array stay in memory.
+///  - Shared: map the file; writes to the array go to the file.
+enum class MapMode {None, Private, Shared};
+
+/// Contents of the header of a .npy file.
+struct NpyHeader
+{
+    std::string descr;
+    bool fortranOrder;
+    Shape shape;
+};
+
+/// Parse the header of the .npy data starting at the current position of
+/// in, leaving in at the first byte of the array data.
+NpyHeader readNpyHeader(std::istream& in);
+
+/// Header of a .npy file (magic, version, length and padded dictionary) for
+/// the given contents. The data that follows is 64-byte aligned.
+std::string npyHeader(const NpyHeader& header);
+
+/// Names of the arrays in a .npz file.
+std::vector<std::string> npz_keys(const std::string& filename);
+
+namespace detail
+{
+    // '<' or '>' for the byte order of this machine.
+    char nativeByteOrder();
+
+    template<typename T>
+    struct npy_kind
+    {
+        static constexpr char kind = std::is_same<T, bool>::value ? 'b'
+            : std::is_floating_point<T>::value ? 'f'
+            : std::is_signed<T>::value ? 'i' : 'u';
+        static constexpr size_t width = sizeof(T);
+    };
+
+    template<typename T>
+    struct npy_kind<std::complex<T> >
+    {
+        static constexpr char kind = 'c';
+        static constexpr size_t width = sizeof(T);
+    };
+
+    template<>
+    struct npy_kind<float16>
+    {
+        static constexpr char kind = 'f';
+        static constexpr size_t width = 2;
+    };
+
+    template<typename T>
+    std::string npyDescr()
+    {
+        const char order = sizeof(T) == 1 ? '|' : nativeByteOrder();
+        return order + std::string(1, npy_kind<T>::kind) + std::to_string(sizeof(T));
+    }
+
+    // Whether the data described by descr is T with the other byte order.
+    // Throws if it is not T at all.
+    template<typename T>
+    bool checkDescr(const std::string& descr)
+    {
+        const std::string expected = npyDescr<T>();
+        if(descr.size() < 2 || descr.substr(1) != expected.substr(1))
+            throw std::invalid_argument("npy: the file holds " + descr + ", not " + expected);
+
+        return descr[0] != '|' && descr[0] != '=' && descr[0] != expected[0];
+    }
+
+    // Read-only or writable mapping of a range of a file, released with
+    // the last array using it.
+    class MappedFile
+    {
+    public:
+        MappedFile(const std::string& filename, size_t offset, size_t size, MapMode mode);
+
+        unsigned char* data() const {return _data;}
+
+    private:
+        std::shared_ptr<void> _mapping;
+        unsigned char* _data;
+    };
+
+    // Output that keeps count of the bytes written and their CRC-32, as
+    // needed for the entries of a zip file.
+    class NpyStream
+    {
+    public:
+        explicit NpyStream(std::ostream& out) : _out(out), _size(0), _crc(0) {}
+
+        void write(const void* data, size_t numBytes);
+
+        size_t size() const {return _size;}
+        std::uint32_t crc() const {return _crc;}
+
+    private:
+        std::ostream& _out;
+        size_t _size;
+        std::uint32_t _crc;
+    };
+
+    // Large arrays are read and written in blocks of this size.
+    constexpr size_t npyChunkSize = 1 << 22;
+
+    template<typename T>
+    void write_npy(NpyStream& out, const Array<T>& arr)
+    {
+        const bool fortran = !arr.isContiguous() && arr.isFContiguous();
+        const std::string header = npyHeader({npyDescr<T>(), fortran, arr.shape()});
+        out.write(header.data(), header.size());
+
+        const size_t numBytes = arr.numElements() * sizeof(T);
+        if(arr.isDense())
+        {
+            const unsigned char* data = firstByte(arr);
+            for(size_t done = 0; done < numBytes; done += npyChunkSize)
+                out.write(data + done, std::min(npyChunkSize, numBytes - done));
+            return;
+        }
+
+        // Strided views go out through a bounce buffer, row by row.
+        std::vector<T> buffer;
+        buffer.reserve(npyChunkSize / sizeof(T) + 1);
+        auto push = [&](const T& value)
+        {
+            buffer.push_back(value);
+            if(buffer.size() * sizeof(T) >= npyChunkSize)
+            {
+                out.write(buffer.data(), buffer.size() * sizeof(T));
+                buffer.clear();
+            }
+        };
+
+        const int ndims = arr.ndims();
+        if(ndims > maxViewDims)
+        {
+            // Too many dimensions for the row loop.
+            for(const T& value : arr)
+                push(value);
+        } else
+        {
+            const std::ptrdiff_t stride = arr.strides()[ndims-1];
+            strided_for_each_row<1>(ndims, arr.shape().data(), {{firstByte(arr)}}, {{arr.strides().data()}},
+                [&](const std::array<unsigned char*, 1>& p, size_t n)
+                {
+                    const unsigned char* in = p[0];
+                    for(size_t j = 0; j < n; ++j, in += stride)
+                        push(*reinterpret_cast<const T*>(in));
+                });
+        }
+        out.write(buffer.data(), buffer.size() * sizeof(T));
+    }
+
+    // Array from .npy data whose header has already been read; the data
+    // starts at byte offset of filename, where in is positioned.
+    template<typename T>
+    Array<T> load_npy_data(std::istream& in, const std::string& filename, size_t offset,
+        const NpyHeader& header, MapMode mode)
+    {
+        const bool swapped = checkDescr<T>(header.descr);
+        const Strides strides = contiguousStrides(header.shape, sizeof(T), header.fortranOrder ? Order::F : Order::C);
+        const size_t numBytes = prod(header.shape) * sizeof(T);
+
+        if(mode != MapMode::None)
+        {
+            if(swapped)
+                throw std::invalid_argument("npy: cannot map data with a different byte order");
+
+            MappedFile mapping(filename, offset, numBytes, mode);
+            return external<T>(reinterpret_cast<T*>(mapping.data()), header.shape, strides, mapping);
+        }
+
+        Manager::Ptr manager = SimpleManager::allocate(numBytes, cacheLineSize);
+        char* data = reinterpret_cast<char*>(manager->data());
+        for(size_t done = 0; done < numBytes; done += npyChunkSize)
+            if(!in.read(data + done, std::min(npyChunkSize, numBytes - done)))
+                throw std::runtime_error("npy: unexpected end of file in " + filename);
+
+        if(swapped)
+            byteswap(data, numBytes, npy_kind<T>::width);
+
+        return Array<T>(ArrayCore(header.shape, strides, manager, 0));
+    }
+
+    // Position of the .npy data of entry name in a .npz file.
+    size_t npzEntryOffset(std::istream& in, const std::string& name);
+}
+
+/// Read a .npy file holding elements of type T, or map it into memory.
+template<typename T>
+Array<T> load_npy(const std::string& filename, MapMode mode=MapMode::None)
+{
+    std::ifstream file(filename, std::ios::in|std::ios::binary);
+    if(!file)
+        throw std::runtime_error("cannot open " + filename);
+
+    NpyHeader header = readNpyHeader(file);
+    return detail::load_npy_data<T>(file, filename, file.tellg(), header, mode);
+}
+
+/// Write arr to a .npy file. C and Fortran contiguous arrays are written
+/// directly; other views are streamed through a small buffer.
+template<typename T>
+void save_npy(const std::string& filename, const Array<T>& arr)
+{
+    std::ofstream file(filename, std::ios::out|std::ios::binary|std::ios::trunc);
+    if(!file)
+        throw std::runtime_error("cannot open " + filename);
+
+    detail::NpyStream out(file);
+    detail::write_npy(out, arr);
+}
+
+/// Read the array name from an uncompressed .npz file.
+template<typename T>
+Array<T> load_npz(const std::string& filename, const std::string& name, MapMode mode=MapMode::None)
+{
+    std::ifstream file(filename, std::ios::in|std::ios::binary);
+    if(!file)
+        throw std::runtime_error("cannot open " + filename);
+
+    file.seekg(detail::npzEntryOffset(file, name));
+    NpyHeader header = readNpyHeader(file);
+    return detail::load_npy_data<T>(file, filename, file.tellg(), header, mode);
+}
+
+/// Writer of uncompressed .npz files, as numpy.savez:
+/// \code
+/// NpzWriter npz("data.npz");
+/// npz.add("x", x);
+/// npz.add("y", y);
+/// npz.close();
+/// \endcode
+class NpzWriter
+{
+public:
+    explicit NpzWriter(const std::string& filename);
+    ~NpzWriter();
+
+    NpzWriter(const NpzWriter&) = delete;
+
+    template<typename T>
+    void add(const std::string& name, const Array<T>& arr)
+    {
+        const size_t offset = beginEntry(name);
+        detail::NpyStream out(_file);
+        detail::write_npy(out, arr);
+        endEntry(offset, out.crc(), out.size());
+    }
+
+    /// Write the zip directory. Called by the destructor if needed.
+    void close();
+
+private:
+    struct Entry
+    {
+        std::string name;
+        size_t offset;
+        std::uint32_t crc;
+        size_t size;
+    };
+
+    size_t beginEntry(const std::string& name);
+    void endEntry(size_t offset, std::uint32_t crc, size_t size);
+
+    std::ofstream _file;
+    std::vector<Entry> _entries;
+    bool _closed;
+};
+
+/*! @} */
+
+}
+
+#endif
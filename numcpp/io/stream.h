@@ -0,0 +1,292 @@
+#ifndef NUMCPP_STREAM_H
+#define NUMCPP_STREAM_H
+
+#include <string>
+#include <fstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "../core.h"
+#include "file.h"
+
+namespace numcpp
+{
+
+/*!
+@file
+
+@addtogroup io
+@{
+*/
+
+/// Sequential reader of the fixed-size frames of a raw file.
+///
+/// A background thread reads ahead up to depth frames into a ring of
+/// preallocated buffers, so that reading the next frame overlaps with the
+/// processing of the current one. next() hands out the buffers themselves;
+/// a buffer is refilled once every array sharing it has been released.
+/// At least two buffers are used, because the loop below still holds the
+/// current frame while it asks for the next one; frames kept beyond the
+/// loop need a larger depth.
+/// \code
+/// FrameStream<int16_t> frames(filename, M);
+/// for(Array<int16_t> frame = frames.next(); frame.numElements() > 0; frame = frames.next())
+///   process(frame);
+/// \endcode
+template<typename T>
+class FrameStream
+{
+public:
+    FrameStream(const std::string& filename, size_t frameSize, size_t depth=2)
+        : _state(std::make_shared<State>(filename, frameSize, depth))
+        , _frameSize(frameSize)
+    {
+        std::shared_ptr<State> state = _state;
+        _thread = std::thread([state]{state->readLoop();});
+    }
+
+    FrameStream(const FrameStream&) = delete;
+
+    ~FrameStream()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            _state->stop = true;
+        }
+        _state->condition.notify_all();
+        _thread.join();
+    }
+
+    size_t numFrames() const {return _state->numFrames;}
+
+    /// The next frame, or an empty array after the last one. Blocks until
+    /// the frame has been read.
+    Array<T> next()
+    {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        _state->condition.wait(lock, [this]
+        {
+            return !_state->ready.empty() || _state->done || _state->error;
+        });
+
+        if(_state->error)
+            std::rethrow_exception(_state->error);
+
+        if(_state->ready.empty())
+            return empty<T>({0});
+
+        const size_t slot = _state->ready.front();
+        _state->ready.pop_front();
+        lock.unlock();
+
+        // The slot goes back to the reader when the last array using it is
+        // destroyed. The release keeps the state alive, even if the array
+        // outlives the stream.
+        std::shared_ptr<State> state = _state;
+        SlotOwner owner{std::shared_ptr<void>(nullptr, [state, slot](void*){state->release(slot);})};
+        T* data = reinterpret_cast<T*>(_state->buffers[slot]->data());
+        return external<T>(data, {_frameSize}, owner);
+    }
+
+private:
+    struct SlotOwner
+    {
+        std::shared_ptr<void> release;
+    };
+
+    struct State
+    {
+        State(const std::string& filename, size_t frameSize, size_t depth)
+            : file(filename)
+            , frameBytes(frameSize * sizeof(T))
+            , numFrames(frameBytes > 0 ? filesize(filename) / frameBytes : 0)
+            , done(false), stop(false)
+        {
+            for(size_t k = 0; k < std::max<size_t>(2, depth); ++k)
+            {
+                buffers.push_back(SimpleManager::allocate(frameBytes, cacheLineSize));
+                freeSlots.push_back(k);
+            }
+        }
+
+        void readLoop()
+        {
+            try
+            {
+                for(size_t frame = 0; frame < numFrames; ++frame)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this]{return !freeSlots.empty() || stop;});
+                    if(stop)
+                        return;
+
+                    const size_t slot = freeSlots.front();
+                    freeSlots.pop_front();
+                    lock.unlock();
+
+                    detail::readAt(file.fd(), buffers[slot]->data(), frameBytes, frame * frameBytes);
+
+                    lock.lock();
+                    ready.push_back(slot);
+                    condition.notify_all();
+                }
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            condition.notify_all();
+        }
+
+        void release(size_t slot)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots.push_back(slot);
+            condition.notify_all();
+        }
+
+        detail::InputFile file;
+        const size_t frameBytes;
+        const size_t numFrames;
+        std::vector<Manager::Ptr> buffers;
+        std::deque<size_t> freeSlots;
+        std::deque<size_t> ready;
+        bool done;
+        bool stop;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    std::shared_ptr<State> _state;
+    size_t _frameSize;
+    std::thread _thread;
+};
+
+/// Sequential writer that appends arrays to a raw file from a background
+/// thread.
+///
+/// write() copies the array (in C order) into one of depth buffers and
+/// returns; it only blocks while all the buffers wait to be written.
+/// close() waits for the pending writes and is called by the destructor.
+template<typename T>
+class FrameWriter
+{
+public:
+    explicit FrameWriter(const std::string& filename, size_t depth=2)
+        : _file(filename, std::ios::out|std::ios::binary|std::ios::trunc)
+        , _depth(std::max<size_t>(1, depth))
+        , _stop(false), _closed(false)
+    {
+        if(!_file)
+            throw std::runtime_error("cannot open " + filename);
+
+        for(size_t k = 0; k < _depth; ++k)
+            _freeSlots.push_back(k);
+        _buffers.resize(_depth);
+
+        _thread = std::thread([this]{writeLoop();});
+    }
+
+    FrameWriter(const FrameWriter&) = delete;
+
+    ~FrameWriter()
+    {
+        try
+        {
+            close();
+        }
+        catch(...)
+        {}
+    }
+
+    void write(const Array<T>& x)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]{return !_freeSlots.empty() || _error;});
+        if(_error)
+            std::rethrow_exception(_error);
+
+        const size_t slot = _freeSlots.front();
+        _freeSlots.pop_front();
+        lock.unlock();
+
+        // Buffers are reused while the frames fit in them.
+        Array<T>& buffer = _buffers[slot];
+        if(buffer.numElements() != x.numElements() || buffer.data() == 0)
+            buffer = empty<T>({size_t(x.numElements())});
+        reshape_nocopy(buffer, x.shape()).deep() = x;
+
+        lock.lock();
+        _pending.push_back(slot);
+        _condition.notify_all();
+    }
+
+    /// Write the pending frames and close the file.
+    void close()
+    {
+        if(_closed)
+            return;
+        _closed = true;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+        _thread.join();
+        _file.close();
+
+        if(_error)
+            std::rethrow_exception(_error);
+    }
+
+private:
+    void writeLoop()
+    {
+        while(true)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]{return !_pending.empty() || _stop;});
+            if(_pending.empty())
+                return;
+
+            const size_t slot = _pending.front();
+            _pending.pop_front();
+            lock.unlock();
+
+            const Array<T>& buffer = _buffers[slot];
+            _file.write(reinterpret_cast<const char*>(buffer.data()), buffer.numElements() * sizeof(T));
+
+            lock.lock();
+            if(!_file && !_error)
+                _error = std::make_exception_ptr(std::runtime_error("FrameWriter: write failed"));
+            _freeSlots.push_back(slot);
+            _condition.notify_all();
+        }
+    }
+
+    std::ofstream _file;
+    size_t _depth;
+    std::vector<Array<T> > _buffers;
+    std::deque<size_t> _freeSlots;
+    std::deque<size_t> _pending;
+    bool _stop;
+    bool _closed;
+    std::exception_ptr _error;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::thread _thread;
+};
+
+/*! @} */
+
+}
+
+#endif
@@ -28,6 +28,7 @@ define_numpy_type(unsigned short, NPY_USHORT);
 define_numpy_type(unsigned int, NPY_UINT);
 define_numpy_type(unsigned long, NPY_ULONG);
 define_numpy_type(unsigned long long, NPY_ULONGLONG);
+define_numpy_type(float16, NPY_HALF);
 define_numpy_type(float, NPY_FLOAT);
 define_numpy_type(double, NPY_DOUBLE);
 define_numpy_type(long double, NPY_LONGDOUBLE);
@@ -35,9 +36,58 @@ define_numpy_type(std::complex<float>, NPY_CFLOAT);
 define_numpy_type(std::complex<double>, NPY_CDOUBLE);
 define_numpy_type(std::complex<long double>, NPY_CLONGDOUBLE);
 
+/// Owner for ExternalManager that keeps a Python object alive while numcpp
+/// arrays point into its memory. The reference is released with the GIL
+/// held, so the last array may die in any thread.
+class PyObjectOwner
+{
+public:
+    explicit PyObjectOwner(PyObject* object)
+        : _object(object)
+    {
+        Py_XINCREF(_object);
+    }
+    
+    PyObjectOwner(const PyObjectOwner& other)
+        : _object(other._object)
+    {
+        Py_XINCREF(_object);
+    }
+    
+    PyObjectOwner& operator=(const PyObjectOwner&) = delete;
+    
+    ~PyObjectOwner()
+    {
+        PyGILState_STATE state = PyGILState_Ensure();
+        Py_XDECREF(_object);
+        PyGILState_Release(state);
+    }
+    
+private:
+    PyObject* _object;
+};
+
+/// Array sharing the memory of a NumPy array of type T, without copying.
+/// The NumPy array is kept alive as long as the result (or any view of it)
+/// exists. Misaligned or byte-swapped arrays are copied first.
 template<class T>
 Array<T> from_numpy(PyArrayObject* pyarray)
 {
+    if(numpy_typemap<T>::numpy_type != PyArray_TYPE(pyarray))
+        throw std::runtime_error("from_numpy: trying to cast array to a different type");
+    
+    if(!PyArray_ISALIGNED(pyarray) || !PyArray_ISNOTSWAPPED(pyarray))
+    {
+        PyArrayObject* aux = (PyArrayObject*)PyArray_FromArray(pyarray,
+                PyArray_DescrFromType(numpy_typemap<T>::numpy_type),
+                NPY_ARRAY_ALIGNED|NPY_ARRAY_ENSURECOPY);
+        if(!aux)
+            throw std::runtime_error("from_numpy: cannot copy the array");
+        Array<T> res = from_numpy<T>(aux);
+        Py_DECREF(aux);
+        return res;
+    }
+    
     int ndims = PyArray_NDIM(pyarray);
     
     npy_intp* pyshape = PyArray_SHAPE(pyarray);
@@ -48,10 +98,7 @@ Array<T> from_numpy(PyArrayObject* pyarray)
     
     T* data = reinterpret_cast<T*>(PyArray_DATA(pyarray));
     
-    if(numpy_typemap<T>::numpy_type == PyArray_TYPE(pyarray))
-        return copy<T>(external<T>(data, shape, strides));
-    else
-        throw std::runtime_error("from_numpy: trying to cast array to a different type");
+    return external<T>(data, shape, strides, PyObjectOwner(reinterpret_cast<PyObject*>(pyarray)));
 }
 
 template<class T>
@@ -62,7 +109,7 @@ Array<T> cast_from_numpy(PyArrayObject* pyarray)
     
     PyArrayObject* aux = (PyArrayObject*)PyArray_FromArray(pyarray,
             PyArray_DescrFromType(numpy_typemap<T>::numpy_type),
-            NPY_DEFAULT|NPY_ARRAY_FORCECAST);
+            NPY_ARRAY_DEFAULT|NPY_ARRAY_FORCECAST);
     if(!aux)
         throw std::runtime_error("cannot cast from numpy array to given type");
     Array<T> res = from_numpy<T>(aux);
@@ -72,22 +119,47 @@ Array<T> cast_from_numpy(PyArrayObject* pyarray)
     return res;
 }
 
+namespace detail
+{
+    constexpr const char* managerCapsuleName = "numcpp.manager";
+    
+    inline void releaseManagerCapsule(PyObject* capsule)
+    {
+        delete static_cast<Manager::Ptr*>(PyCapsule_GetPointer(capsule, managerCapsuleName));
+    }
+}
+
+/// NumPy array sharing the memory of array, without copying. The numcpp
+/// buffer is owned by a capsule set as the base of the NumPy array, so it
+/// outlives whichever side is released last.
 template<class T>
 PyArrayObject* to_numpy(const Array<T>& array)
 {
     int ndims = array.ndims();
-    npy_intp pyshape[ndims];
-    std::copy(array.shape().begin(), array.shape().end(), pyshape);
+    std::vector<npy_intp> pyshape(array.shape().begin(), array.shape().end());
+    std::vector<npy_intp> pystrides(array.strides().begin(), array.strides().end());
+    unsigned char* data = reinterpret_cast<unsigned char*>(array.data()) + array.offset();
     
-    // Create output array.
-    PyArrayObject* res = (PyArrayObject*)PyArray_SimpleNew(ndims, pyshape, numpy_typemap<T>::numpy_type);
+    PyObject* capsule = PyCapsule_New(new Manager::Ptr(array.manager()),
+        detail::managerCapsuleName, detail::releaseManagerCapsule);
+    if(!capsule)
+        throw std::runtime_error("to_numpy: cannot create the buffer owner");
     
-    // Copy data into new NumPy array.
-    npy_intp* pystrides = PyArray_STRIDES(res);
-    Strides strides(pystrides, pystrides+ndims);
-    T* data = reinterpret_cast<T*>(PyArray_DATA(res));    
-    Array<T> aux = external<T>(data, array.shape(), strides);
-    aux.deep() = array;
+    PyArrayObject* res = (PyArrayObject*)PyArray_NewFromDescr(&PyArray_Type,
+        PyArray_DescrFromType(numpy_typemap<T>::numpy_type),
+        ndims, pyshape.data(), pystrides.data(), data, NPY_ARRAY_WRITEABLE, NULL);
+    if(!res)
+    {
+        Py_DECREF(capsule);
+        throw std::runtime_error("to_numpy: cannot create the numpy array");
+    }
+    
+    // Steals the reference to the capsule.
+    if(PyArray_SetBaseObject(res, capsule) < 0)
+    {
+        Py_DECREF(res);
+        throw std::runtime_error("to_numpy: cannot set the base of the numpy array");
+    }
     
     return res;
 }
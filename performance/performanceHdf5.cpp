@@ -0,0 +1,80 @@
+#include <numcpp/core.h>
+#include <numcpp/io.h>
+
+using namespace numcpp;
+
+// Write and read throughput of HDF5 datasets with different storage
+// settings: a stack of frames is written, read back whole, and read back
+// one frame at a time.
+void benchmark(const std::string& name, const Array<float>& x, const H5Storage& storage)
+{
+  const double megabytes = x.numElements() * sizeof(float) / 1e6;
+
+  h5close_all();
+  std::remove("performanceHdf5.h5");
+
+  auto t = tic();
+  h5write(x, "performanceHdf5.h5", "/data", storage);
+  h5flush();
+  double writeTime = toc(t, false) * 1e-6;
+
+  t = tic();
+  Array<float> y = h5read<float>("performanceHdf5.h5", "/data");
+  double readTime = toc(t, false) * 1e-6;
+
+  // The dataset stays open between the reads.
+  t = tic();
+  for(size_t k=0; k<x.shape()[0]; k++)
+    h5read<float>("performanceHdf5.h5", "/data", {int(k)});
+  double frameTime = toc(t, false) * 1e-6;
+
+  std::cout << name << ": "
+            << "write " << megabytes / writeTime << " MB/s, "
+            << "read " << megabytes / readTime << " MB/s, "
+            << "frames " << megabytes / frameTime << " MB/s, "
+            << "file " << filesize("performanceHdf5.h5") / 1e6 << " MB" << std::endl;
+}
+
+int main()
+{
+  size_t N = 64;
+  size_t M = 512;
+
+  // Smooth frames with some noise, which compress moderately.
+  Array<float> x = empty<float>({N, M, M});
+  unsigned int seed = 1;
+  for(size_t k=0; k<N; k++)
+    for(size_t i=0; i<M; i++)
+      for(size_t j=0; j<M; j++)
+      {
+        seed = seed * 1664525u + 1013904223u;
+        x(k,i,j) = std::sin(0.01f*i) * std::cos(0.02f*j) + k + (seed >> 24) / 256.0f;
+      }
+
+  H5Storage storage;
+  benchmark("contiguous", x, storage);
+
+  storage.chunked = true;
+  benchmark("chunked (auto, 1 frame)", x, storage);
+
+  storage.accessAxis = -1;
+  benchmark("chunked (auto, no axis)", x, storage);
+
+  storage.accessAxis = 0;
+  storage.deflate = 1;
+  benchmark("deflate 1", x, storage);
+
+  storage.shuffle = true;
+  benchmark("shuffle + deflate 1", x, storage);
+
+  storage.deflate = 6;
+  benchmark("shuffle + deflate 6", x, storage);
+
+  // Chunks that span several frames are decompressed again for each of
+  // their frames, unless they fit in the chunk cache.
+  storage.accessAxis = -1;
+  h5set_chunk_cache(64 << 20);
+  benchmark("shuffle + deflate 6, no axis, 64 MB cache", x, storage);
+
+  return 0;
+}
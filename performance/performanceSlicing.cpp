@@ -0,0 +1,43 @@
+#include <numcpp/core.h>
+
+using namespace numcpp;
+
+// Cost of taking a row of a matrix inside a loop.
+int main()
+{
+  // Small enough to stay in cache, so that only the indexing is measured.
+  size_t N = 64;
+  size_t M = 100000;
+
+  Array<double> A = ones<double>({N, N});
+  double s;
+
+  std::cout << "operator[] (ArrayRef): ";
+  s = 0;
+  auto t = tic();
+  for(size_t l=0; l<M; l++)
+    for(size_t i=0; i<N; i++)
+      s += A[i](l % N);
+  size_t timeRef = toc(t, false);
+  std::cout << timeRef << " us (" << 1e3*timeRef/(N*M) << " ns/row) " << s << std::endl;
+
+  std::cout << "view(i) (ArrayView): ";
+  s = 0;
+  t = tic();
+  for(size_t l=0; l<M; l++)
+    for(size_t i=0; i<N; i++)
+      s += A.view(i)(l % N);
+  size_t timeView = toc(t, false);
+  std::cout << timeView << " us (" << 1e3*timeView/(N*M) << " ns/row) " << s << std::endl;
+
+  std::cout << "operator()(i, full) (ArrayView): ";
+  s = 0;
+  t = tic();
+  for(size_t l=0; l<M; l++)
+    for(size_t i=0; i<N; i++)
+      s += A(i, full)(l % N);
+  size_t timeSlice = toc(t, false);
+  std::cout << timeSlice << " us (" << 1e3*timeSlice/(N*M) << " ns/row) " << s << std::endl;
+
+  return 0;
+}
@@ -123,3 +123,544 @@ TEST_CASE( "numcpp/core/array/angle", "Angle function" )
   }
 
 }
+
+TEST_CASE( "numcpp/core/cowarray", "Copy-on-write arrays" )
+{
+  resetCowCounters();
+
+  CowArray<double> x = zeros<double>({3,3});
+  CowArray<double> y = x;
+  CowArray<double> z = x;
+
+  REQUIRE( y.array().data() == x.array().data() );
+
+  y(1,1) = 5.0;
+
+  REQUIRE( y.array().data() != x.array().data() );
+  REQUIRE( z.array().data() == x.array().data() );
+  const CowArray<double>& cx = x;
+  REQUIRE( cx(1,1) == 0.0 );
+  REQUIRE( y(1,1) == 5.0 );
+  REQUIRE( cowDetached() == 1 );
+  REQUIRE( cowCopiesAvoided() == 1 );
+
+  // Converting a live array shares its buffer.
+  resetCowCounters();
+  Array<double> a = zeros<double>({4});
+  CowArray<double> c = cow(a);
+  REQUIRE( cowShared() == 1 );
+  c(0) = 1.0;
+  REQUIRE( a(0) == 0.0 );
+  REQUIRE( cowDetached() == 1 );
+  REQUIRE( cowCopiesAvoided() == 0 );
+
+  // Temporaries are not shared.
+  resetCowCounters();
+  CowArray<double> t = cow(zeros<double>({4}));
+  t(0) = 1.0;
+  REQUIRE( cowShared() == 0 );
+  REQUIRE( cowDetached() == 0 );
+  REQUIRE( cowCopiesAvoided() == 0 );
+
+  // Moves and self-assignment are not shares.
+  std::vector<CowArray<double> > arrays;
+  for(int i=0; i<10; i++)
+    arrays.push_back(cow(zeros<double>({2})));
+  CowArray<double> moved = std::move(t);
+  t = std::move(moved);
+  t = t;
+  REQUIRE( cowShared() == 0 );
+  REQUIRE( !t.isShared() );
+}
+
+TEST_CASE( "numcpp/core/arrayview", "Non-owning array views" )
+{
+  Array<double> x = zeros<double>({3,4});
+  for(int i=0; i<3; i++)
+    for(int j=0; j<4; j++)
+      x(i,j) = 4*i+j;
+
+  ConstArrayView<double> v = x;
+  REQUIRE( v(2,1) == 9 );
+  REQUIRE( sum(v) == 66 );
+  REQUIRE( mean(v) == 5.5 );
+
+  ArrayView<const double> row = x[1];
+  auto y = array_map([](double a, double b){return a*b;}, v, row);
+  REQUIRE( y(2,3) == 11*7 );
+
+  auto s = sum(v, 0);
+  REQUIRE( s.shape() == Shape({4}) );
+  REQUIRE( s(1) == 1+5+9 );
+
+  std::vector<double> vec = {1, 2, 3};
+  REQUIRE( sum(view(vec)) == 6 );
+
+  double buffer[] = {1, 4, 9, 16};
+  ArrayView<double> b(buffer, {2,2});
+  REQUIRE( sqrt(ConstArrayView<double>(b))(1,1) == 4 );
+
+  // Strided loops refuse ranks they cannot count.
+  size_t shape[10] = {1,1,1,1,1,1,1,1,1,2};
+  std::ptrdiff_t strides[10] = {0,0,0,0,0,0,0,0,0,16};
+  REQUIRE_THROWS( detail::strided_for_each_row<1>(10, shape, {{(unsigned char*)buffer}}, {{strides}},
+    [](const std::array<unsigned char*, 1>&, size_t){}) );
+}
+
+TEST_CASE( "numcpp/core/array/variadicslicing", "Allocation-free variadic slicing" )
+{
+  Array<int> x = zeros<int>({4,5});
+  for(int i=0; i<4; i++)
+    for(int j=0; j<5; j++)
+      x(i,j) = 10*i+j;
+
+  auto row = x.view(2);
+  REQUIRE( row.ndims() == 1 );
+  REQUIRE( row(3) == 23 );
+
+  auto sub = x(S{1,3}, S{0,5,2});
+  REQUIRE( sub.ndims() == 2 );
+  REQUIRE( sub.shape(0) == 2 );
+  REQUIRE( sub.shape(1) == 3 );
+  REQUIRE( sub(1,2) == 24 );
+
+  auto col = x(full, -1);
+  REQUIRE( col.ndims() == 1 );
+  REQUIRE( col(3) == 34 );
+
+  auto ext = x(newaxis, 1);
+  REQUIRE( ext.ndims() == 2 );
+  REQUIRE( ext(0,4) == 14 );
+
+  sub(0,0) = -1;
+  REQUIRE( x(1,0) == -1 );
+
+  REQUIRE( x[3](1) == 31 );
+
+  // Views from operator() keep the buffer of a temporary alive.
+  auto make = [&x]{return copy(x);};
+  auto tail = make()(3, S{1,5});
+  REQUIRE( tail.owner().use_count() == 1 );
+  REQUIRE( tail(2) == 33 );
+  REQUIRE( !x.view(S{0,2}).owner() );
+}
+
+TEST_CASE( "numcpp/core/apply_along_axis", "Slab iteration and apply_along_axis" )
+{
+  Array<double> x = zeros<double>({300,400});
+  for(int i=0; i<300; i++)
+    for(int j=0; j<400; j++)
+      x(i,j) = i+j;
+
+  auto s = sum(x, 0);
+  REQUIRE( s.shape() == Shape({400}) );
+  REQUIRE( s(7) == 300*7 + 299*300/2 );
+
+  auto rowSums = apply_along_axis([](const Array<double>& a){return sum(a);}, x, 1);
+  REQUIRE( rowSums.shape() == Shape({300}) );
+  REQUIRE( rowSums(5) == 400*5 + 399*400/2 );
+
+  auto colMax = apply_along_axis([](const Array<double>& a){return *std::max_element(a.begin(), a.end());}, x, 0);
+  REQUIRE( colMax.shape() == Shape({400}) );
+  REQUIRE( colMax(10) == 299+10 );
+
+  auto firstTwo = apply_along_axis([](const Array<double>& a){return copy(Array<double>(a[{S{0,2}}]));}, x, 0);
+  REQUIRE( firstTwo.shape() == Shape({2,400}) );
+  REQUIRE( firstTwo(1,3) == 4 );
+
+  // No lanes: an empty result with the axis of the input.
+  auto noLanes = apply_along_axis([](const Array<double>& l){return copy(l);}, zeros<double>({0,5}), 1);
+  REQUIRE( noLanes.shape() == Shape({0,5}) );
+}
+
+TEST_CASE( "numcpp/core/reshape", "Reshape without copies" )
+{
+  Array<int> x = zeros<int>({4,6});
+  for(int i=0; i<4; i++)
+    for(int j=0; j<6; j++)
+      x(i,j) = 6*i+j;
+
+  // Every other column: uniform stride, can be split without copying.
+  Array<int> cols = x[{full, S{0,6,2}}];
+  auto y = reshape_nocopy(cols, {4,3,1});
+  REQUIRE( y.manager() == x.manager() );
+  REQUIRE( y(2,1,0) == 14 );
+
+  // Merging axes of a row slice keeps sharing the data.
+  Array<int> rows = x[{S{1,3}}];
+  auto z = reshape(rows, {12});
+  REQUIRE( z.manager() == x.manager() );
+  REQUIRE( z(7) == 13 );
+
+  // Every other element of the rows is also a uniform stride overall.
+  REQUIRE( reshape_nocopy(cols, {12})(5) == 10 );
+
+  // Merging non-uniformly strided axes needs a copy.
+  Array<int> block = x[{full, S{0,3}}];
+  REQUIRE_THROWS( reshape_nocopy(block, {12}) );
+  auto w = reshape(block, {12});
+  REQUIRE( w.manager() != x.manager() );
+  REQUIRE( w(4) == 7 );
+
+  // Broadcasted axes.
+  auto b = broadcast(Array<int>(x[0]), {5,6});
+  auto bb = reshape_nocopy(b, {5,2,3});
+  REQUIRE( bb(4,1,2) == 5 );
+
+  // Fortran index order.
+  auto f = reshape(x, {6,4}, Order::F);
+  REQUIRE( f(1,0) == 6 );
+  REQUIRE( f(0,1) == 13 );
+  auto g = reshape(cols, {12}, Order::F);
+  REQUIRE( g(1) == 6 );
+  REQUIRE( g(4) == 2 );
+  auto h = reshape(block, {12}, Order::F);
+  REQUIRE( h(1) == 6 );
+  REQUIRE( h(4) == 1 );
+}
+
+TEST_CASE( "numcpp/core/order", "Column-major arrays" )
+{
+  auto x = zeros<double>({3,4}, Order::F);
+  REQUIRE( x.strides() == Strides({8,24}) );
+  REQUIRE( x.isFContiguous() );
+  REQUIRE_FALSE( x.isContiguous() );
+  REQUIRE( x.order() == Order::F );
+
+  for(int i=0; i<3; i++)
+    for(int j=0; j<4; j++)
+      x(i,j) = 4*i+j;
+
+  REQUIRE( x.cont_begin()[1] == 4 );
+  REQUIRE( sum(x) == 66 );
+
+  auto y = x * x;
+  REQUIRE( y.order() == Order::F );
+  REQUIRE( y(2,3) == 121 );
+
+  auto c = copy(x);
+  REQUIRE( c.isContiguous() );
+  REQUIRE( c(1,2) == 6 );
+
+  auto k = copy(x, Order::Keep);
+  REQUIRE( k.isFContiguous() );
+  REQUIRE( k(1,2) == 6 );
+
+  auto r = reshape(x, {12}, Order::Keep);
+  REQUIRE( r.manager() == x.manager() );
+  REQUIRE( r(1) == 4 );
+
+  auto mixed = x + c;
+  REQUIRE( mixed(2,1) == 18 );
+}
+
+TEST_CASE( "numcpp/core/pitched", "Pitched allocation" )
+{
+  auto x = empty_pitched<double>({8,1024});
+  REQUIRE( x.strides()[1] == 8 );
+  REQUIRE( x.strides()[0] == 1024*8 + 64 );
+  REQUIRE( (reinterpret_cast<std::uintptr_t>(x.data()) % 64) == 0 );
+  REQUIRE_FALSE( x.isContiguous() );
+
+  auto y = empty_pitched<float>({3,5,7}, Padding::Align);
+  REQUIRE( y.strides() == Strides({5*64, 64, 4}) );
+
+  for(int i=0; i<8; i++)
+    for(int j=0; j<1024; j++)
+      x(i,j) = i-j;
+
+  auto c = copy(x);
+  REQUIRE( c.isContiguous() );
+  REQUIRE( c(7,1000) == -993 );
+
+  auto z = x + x;
+  REQUIRE( z(3,2) == 2 );
+
+  auto p = empty_pitched<double>({8,1024});
+  p.deep() = c;
+  REQUIRE( p(5,6) == -1 );
+}
+
+TEST_CASE( "numcpp/core/stacking", "Concatenate, stack and tile" )
+{
+  Array<int> a = zeros<int>({2,3});
+  Array<int> b = ones<int>({1,3});
+  Array<int> c = ones<int>({2,2});
+
+  auto x = concatenate<int>({a, b}, 0);
+  REQUIRE( x.shape() == Shape({3,3}) );
+  REQUIRE( x(1,2) == 0 );
+  REQUIRE( x(2,1) == 1 );
+
+  auto y = concatenate<int>({a, c}, -1);
+  REQUIRE( y.shape() == Shape({2,5}) );
+  REQUIRE( y(1,2) == 0 );
+  REQUIRE( y(1,3) == 1 );
+  REQUIRE( hstack<int>({a, c}).shape() == Shape({2,5}) );
+
+  auto s = stack<int>({a, a, a}, 1);
+  REQUIRE( s.shape() == Shape({2,3,3}) );
+
+  Array<int> r = zeros<int>({3});
+  r(1) = 7;
+  auto v = vstack<int>({r, r});
+  REQUIRE( v.shape() == Shape({2,3}) );
+  REQUIRE( v(1,1) == 7 );
+
+  auto t = tile(r, {2,2});
+  REQUIRE( t.shape() == Shape({2,6}) );
+  REQUIRE( t(1,4) == 7 );
+  REQUIRE( t(1,3) == 0 );
+
+  Array<int> big = ones<int>({300,300});
+  auto bb = concatenate<int>({big, big, Array<int>(big[{S{0,300,2}}])}, 0);
+  REQUIRE( bb.shape() == Shape({750,300}) );
+  REQUIRE( sum(bb) == 750*300 );
+}
+
+TEST_CASE( "numcpp/core/mask", "Boolean masks" )
+{
+  Array<int> x = zeros<int>({3,4});
+  for(int i=0; i<3; i++)
+    for(int j=0; j<4; j++)
+      x(i,j) = 4*i+j;
+
+  Array<bool> mask = x > Array<int>(5);
+  REQUIRE( count_nonzero(mask) == 6 );
+
+  auto w = where(mask, x, zeros<int>({3,4}));
+  REQUIRE( w(1,1) == 0 );
+  REQUIRE( w(1,2) == 6 );
+
+  auto c = x[mask];
+  REQUIRE( c.shape() == Shape({6}) );
+  REQUIRE( c(0) == 6 );
+  REQUIRE( c(5) == 11 );
+
+  x.masked(mask) = -1;
+  REQUIRE( x(2,3) == -1 );
+  REQUIRE( x(1,1) == 5 );
+
+  Array<int> values = zeros<int>({6});
+  values(5) = 42;
+  x.masked(mask) = values;
+  REQUIRE( x(2,3) == 42 );
+  REQUIRE( x(1,2) == 0 );
+
+  Array<double> big = zeros<double>({1000,300});
+  for(int i=0; i<1000; i++)
+    big(i, i % 300) = i;
+  Array<bool> nz = big != Array<double>(0.0);
+  auto picked = big[nz];
+  REQUIRE( picked.numElements() == 999 );
+  REQUIRE( picked(998) == 999 );
+}
+
+TEST_CASE( "numcpp/core/take", "Integer array indexing" )
+{
+  Array<int> x = zeros<int>({4,5});
+  for(int i=0; i<4; i++)
+    for(int j=0; j<5; j++)
+      x(i,j) = 10*i+j;
+
+  Array<size_t> idx = zeros<size_t>({3});
+  idx(0) = 3; idx(1) = 0; idx(2) = 3;
+
+  auto rows = x[idx];
+  REQUIRE( rows.shape() == Shape({3,5}) );
+  REQUIRE( rows(0,4) == 34 );
+  REQUIRE( rows(1,1) == 1 );
+
+  auto cols = take(x, idx, 1);
+  REQUIRE( cols.shape() == Shape({4,3}) );
+  REQUIRE( cols(2,0) == 23 );
+
+  Array<int> t = x.T();
+  auto trows = t[idx];
+  REQUIRE( trows.shape() == Shape({3,4}) );
+  REQUIRE( trows(0,2) == 23 );
+
+  Array<size_t> bad = zeros<size_t>({1});
+  bad(0) = 9;
+  REQUIRE_THROWS( take(x, bad, 1) );
+
+  put(x, idx, Array<int>(-1));
+  REQUIRE( x(0,3) == -1 );
+  REQUIRE( x(0,0) == -1 );
+  REQUIRE( x(0,1) == 1 );
+}
+
+TEST_CASE( "numcpp/core/cast", "Type conversions" )
+{
+  Array<double> x = zeros<double>({2,3});
+  x(0,0) = 2.5; x(0,1) = -3.7; x(0,2) = 1e6;
+  x(1,0) = -1e6; x(1,1) = 3.5; x(1,2) = std::nan("");
+
+  Array<short> t = cast<short>(x(S{0,1}, S{0,2}));
+  REQUIRE( t(0,0) == 2 );
+  REQUIRE( t(0,1) == -3 );
+
+  Array<short> r = cast<short>(x(S{0,1}, S{0,2}), CastMode::Round);
+  REQUIRE( r(0,0) == 2 );
+  REQUIRE( r(0,1) == -4 );
+
+  Array<short> s = cast<short>(x, CastMode::RoundSaturate);
+  REQUIRE( s(0,2) == 32767 );
+  REQUIRE( s(1,0) == -32768 );
+  REQUIRE( s(1,1) == 4 );
+  REQUIRE( s(1,2) == 0 );
+
+  Array<int> big = zeros<int>({3});
+  big(0) = 300; big(1) = -5; big(2) = 7;
+  Array<unsigned char> u = cast<unsigned char>(big, CastMode::Saturate);
+  REQUIRE( u(0) == 255 );
+  REQUIRE( u(1) == 0 );
+  REQUIRE( u(2) == 7 );
+
+  Array<std::complex<double> > c = cast<std::complex<double> >(big);
+  REQUIRE( c(1) == std::complex<double>(-5, 0) );
+
+  Array<float> out = zeros<float>({3,2});
+  cast_into(out.T(), x);
+  REQUIRE( out(1,1) == 3.5f );
+  REQUIRE( out(2,0) == 1e6f );
+
+  REQUIRE_THROWS( cast_into(out, x) );
+
+  // Strided arrays of more than maxViewDims dimensions.
+  Array<double> deep = zeros<double>({2,1,1,1,1,1,1,1,1,6});
+  for(int i=0; i<12; i++)
+    deep.data()[i] = i;
+  std::vector<Index> stepped(9, Slice());
+  stepped.push_back(Slice(0,6,2));
+  Array<double> v = deep[stepped];
+  Array<int> out10 = zeros<int>(v.shape());
+  cast_into(out10, v);
+  REQUIRE( out10(1,0,0,0,0,0,0,0,0,2) == 10 );
+}
+
+TEST_CASE( "numcpp/core/half", "Half precision types" )
+{
+  REQUIRE( float(float16(1.5)) == 1.5f );
+  REQUIRE( float16(1.0f).bits() == 0x3c00 );
+  REQUIRE( float(float16(1.0f + 1.0f/2048)) == 1.0f );
+  REQUIRE( float(float16(65504.0f)) == 65504.0f );
+  REQUIRE( std::isinf(float(float16(70000.0f))) );
+  REQUIRE( float(float16(std::ldexp(1.0f, -24))) == std::ldexp(1.0f, -24) );
+  REQUIRE( std::isnan(float(float16(std::nanf("")))) );
+  REQUIRE( float(-float16(2.0f)) == -2.0f );
+
+  REQUIRE( float(bfloat16(3.0f)) == 3.0f );
+  REQUIRE( bfloat16(1.0f).bits() == 0x3f80 );
+  REQUIRE( float(bfloat16(1.0f + 1.0f/256)) == 1.0f );
+
+  float16 a(0.5f), b(0.25f);
+  REQUIRE( float(a + b) == 0.75f );
+  REQUIRE( (a * 2.0f) == 1.0f );
+
+  Array<float> x = zeros<float>({2,9});
+  x(1,8) = 3.25f;
+  x(0,3) = -0.125f;
+  Array<float16> h = cast<float16>(x);
+  REQUIRE( float(h(1,8)) == 3.25f );
+  Array<float> y = cast<float>(h);
+  REQUIRE( y(0,3) == -0.125f );
+  Array<int> i = cast<int>(h, CastMode::Round);
+  REQUIRE( i(1,8) == 3 );
+  Array<bfloat16> bh = cast<bfloat16>(y.T());
+  REQUIRE( float(bh(8,1)) == 3.25f );
+}
+
+TEST_CASE( "numcpp/core/bitmask", "Bit-packed masks" )
+{
+  Array<int> x = zeros<int>({10,13});
+  for(int i=0; i<10; i++)
+    for(int j=0; j<13; j++)
+      x(i,j) = 13*i+j;
+
+  BitMask m = less_mask(x, 70);
+  REQUIRE( m.shape() == x.shape() );
+  REQUIRE( m.numWords() == 3 );
+  REQUIRE( count_nonzero(m) == 70 );
+  REQUIRE( any(m) );
+  REQUIRE( !all(m) );
+  REQUIRE( all(m | ~m) );
+  REQUIRE( !any(m & ~m) );
+  REQUIRE( count_nonzero(~m) == 60 );
+
+  BitMask odd = bitmask_map([](int a){return a % 2 == 1;}, x);
+  REQUIRE( count_nonzero(odd) == 65 );
+  REQUIRE( count_nonzero(odd ^ m) == 65 );
+
+  BitMask packed(x < Array<int>(70));
+  REQUIRE( all(~(packed ^ m)) );
+  Array<bool> unpacked = m.unpack();
+  REQUIRE( unpacked(5,4) );
+  REQUIRE( !unpacked(5,5) );
+
+  Array<int> c = x[m & odd];
+  REQUIRE( c.shape() == Shape({35}) );
+  REQUIRE( c(0) == 1 );
+  REQUIRE( c(34) == 69 );
+
+  Array<int> w = where(m, x, Array<int>(zeros<int>({10,13})));
+  REQUIRE( w(5,4) == 69 );
+  REQUIRE( w(5,5) == 0 );
+
+  Array<int> y = copy(x);
+  y.masked(m) = 0;
+  REQUIRE( y(5,4) == 0 );
+  REQUIRE( y(5,5) == 70 );
+
+  Array<int> t = x.T();
+  BitMask tm = greater_equal_mask(t, 120);
+  t.masked(tm) = -1;
+  REQUIRE( x(9,2) == 119 );
+  REQUIRE( x(9,3) == -1 );
+
+  y.masked(odd) = compress(x, odd) * Array<int>(10);
+  REQUIRE( y(8,1) == 1050 );
+  REQUIRE( y(9,1) == 118 );
+  REQUIRE_THROWS( y.masked(odd) = Array<int>(zeros<int>({3})) );
+}
+
+TEST_CASE( "numcpp/core/planar", "Planar complex arrays" )
+{
+  typedef std::complex<double> cdouble;
+  Array<cdouble> x = zeros<cdouble>({3,8});
+  for(int i=0; i<3; i++)
+    for(int j=0; j<8; j++)
+      x(i,j) = cdouble(i+j, i-j);
+
+  Array<double> re = real(x);
+  REQUIRE( re(2,5) == 7 );
+  REQUIRE( imag(x)(2,5) == -3 );
+  re(0,0) = 10;
+  REQUIRE( x(0,0) == cdouble(10, 0) );
+
+  PlanarComplex<double> p = to_planar(x);
+  REQUIRE( p.shape() == x.shape() );
+  REQUIRE( p.real()(1,2) == 3 );
+  REQUIRE( p.imag()(1,2) == -1 );
+  REQUIRE( p.imag().data() == p.real().data() );
+
+  PlanarComplex<double> q = p * p + cdouble(0, 1) * p - p;
+  Array<cdouble> xq = to_interleaved(q);
+  cdouble v = x(1,2);
+  REQUIRE( std::abs(xq(1,2) - (v*v + cdouble(0,1)*v - v)) < 1e-12 );
+
+  PlanarComplex<double> e = exp(p);
+  REQUIRE( std::abs(e(std::vector<size_t>{2,3}) - std::exp(x(2,3))) < 1e-9 );
+  REQUIRE( std::abs(sum(p) - std::accumulate(x.begin(), x.end(), cdouble(0))) < 1e-12 );
+
+  PlanarComplex<double> f = fft(p);
+  cdouble dft = 0;
+  for(int j=0; j<8; j++)
+    dft += x(1,j) * std::exp(cdouble(0, -2*std::acos(-1.0)*3*j/8));
+  REQUIRE( std::abs(f(std::vector<size_t>{1,3}) - dft) < 1e-9 );
+
+  Array<cdouble> back = to_interleaved(ifft(f));
+  REQUIRE( std::abs(back(2,7) - x(2,7)) < 1e-12 );
+
+  REQUIRE_THROWS( fft(to_planar(Array<cdouble>(zeros<cdouble>({6})))) );
+}
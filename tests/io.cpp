@@ -6,8 +6,9 @@
   template<class T>
   void testHdf5()
   {
-      Array<T> A(3,3);
-      A = range(0,9);
+      Array<T> A = zeros<T>({3,3});
+      for(int i=0; i<9; i++)
+        A(i/3, i%3) = T(i);
 
       auto file = h5create("test.h5");
       h5write(A, file, "/testData");
@@ -15,7 +16,7 @@
 
       auto B = h5read<T>("test.h5", "/testData");
 
-      REQUIRE( all(A == B) );
+      REQUIRE( all(equal_mask(A, B)) );
   }
 
   TEST_CASE( "numcpp/io/hdf5", "HDF5 Test" ) {
@@ -34,4 +35,447 @@
         testHdf5<int>();
       }
 
+      SECTION( "Integers", "All integer widths")
+      {
+        testHdf5<int8_t>();
+        testHdf5<uint8_t>();
+        testHdf5<int16_t>();
+        testHdf5<uint16_t>();
+        testHdf5<uint32_t>();
+        testHdf5<int64_t>();
+        testHdf5<uint64_t>();
+        testHdf5<long long>();
+      }
+
+      SECTION( "Other", "Half, long double and complex")
+      {
+        testHdf5<float16>();
+        testHdf5<long double>();
+        testHdf5<std::complex<float>>();
+        testHdf5<std::complex<double>>();
+      }
+
+  }
+
+  TEST_CASE( "numcpp/io/hdf5/types", "HDF5 type conversions" ) {
+
+      Array<int16_t> A = zeros<int16_t>({2,3});
+      for(int i=0; i<6; i++)
+        A(i/3, i%3) = -1000 * i;
+      h5write(A, "types.h5", "/int16");
+
+      // HDF5 converts while reading.
+      Array<double> B = h5read<double>("types.h5", "/int16");
+      REQUIRE( B(1,2) == -5000 );
+
+      Array<float> C = zeros<float>({2,6});
+      h5read_into<float>(C[{Slice(), Slice(0,6,2)}], "types.h5", "/int16");
+      REQUIRE( C(1,4) == -5000 );
+
+      Array<std::complex<float>> Z = zeros<std::complex<float>>({4});
+      Z(3) = std::complex<float>(1.5f, -2.0f);
+      h5write(Z, "types.h5", "/complex");
+      Array<std::complex<double>> W = h5read<std::complex<double>>("types.h5", "/complex");
+      REQUIRE( W(3) == std::complex<double>(1.5, -2.0) );
+
+      Array<bool> M = zeros<bool>({5});
+      M(1) = true;
+      M(4) = true;
+      h5write(M, "types.h5", "/mask");
+      REQUIRE( all(equal_mask(M, h5read<bool>("types.h5", "/mask"))) );
+
+      Array<float16> H = h5read<float16>("types.h5", "/int16");
+      REQUIRE( float(H(0,1)) == -1000 );
+      h5close_all();
+  }
+
+  TEST_CASE( "numcpp/io/hdf5/hyperslab", "HDF5 hyperslabs" ) {
+
+      Array<double> A = zeros<double>({4,5,6});
+      for(int i=0; i<4; i++)
+        for(int j=0; j<5; j++)
+          for(int k=0; k<6; k++)
+            A(i,j,k) = 100*i + 10*j + k;
+      h5write(A, "test.h5", "/data");
+
+      Array<double> frame = h5read<double>("test.h5", "/data", {2});
+      REQUIRE( frame.shape() == Shape({5,6}) );
+      REQUIRE( frame(3,4) == 234 );
+
+      Array<double> roi = h5read<double>("test.h5", "/data", {Slice(1,4,2), 3, Slice(0,none,2)});
+      REQUIRE( roi.shape() == Shape({2,3}) );
+      REQUIRE( roi(1,2) == 334 );
+
+      // Directly into strided views.
+      Array<double> B = zeros<double>({10,12});
+      h5read_into<double>(B[{Slice(0,10,2), Slice(1,12,2)}], "test.h5", "/data", {1});
+      REQUIRE( B(6,7) == 133 );
+      REQUIRE( B(6,8) == 0 );
+      REQUIRE( B(7,7) == 0 );
+
+      // 1-D stepped views are read in place too.
+      hid_t space = detail::memorySpace({5}, {16}, sizeof(double));
+      REQUIRE( space >= 0 );
+      H5Sclose(space);
+      Array<double> line = zeros<double>({12});
+      h5read_into<double>(line[{Slice(1,12,2)}], "test.h5", "/data", {2, 3});
+      REQUIRE( line(9) == 234 );
+      REQUIRE( line(10) == 0 );
+
+      Array<double> C = zeros<double>({6,5});
+      h5read_into<double>(C.T(), "test.h5", "/data", {0});
+      REQUIRE( C(4,3) == 34 );
+
+      // Strided writes into a region of the dataset.
+      h5write(C.T(), "test.h5", "/data", {3});
+      Array<double> D = zeros<double>({3,2});
+      D(2,1) = -1;
+      h5write(D, "test.h5", "/data", {0, Slice(2,5), Slice(4,6)});
+      Array<double> E = h5read<double>("test.h5", "/data");
+      REQUIRE( E(3,3,4) == 34 );
+      REQUIRE( E(0,4,5) == -1 );
+      REQUIRE( E(0,4,3) == 43 );
+
+      REQUIRE_THROWS( h5read<double>("test.h5", "/data", {Slice(0,4,-1)}) );
+      REQUIRE_THROWS( h5write(D, "test.h5", "/data", {0}) );
+  }
+
+  TEST_CASE( "numcpp/io/hdf5/storage", "Chunked and compressed HDF5 datasets" ) {
+
+      REQUIRE( detail::h5chunkShape({1000,512,512}, 4, 0) == Shape({1,512,512}) );
+      REQUIRE( detail::h5chunkShape({1000,512,512}, 8, -1) == Shape({63,32,64}) );
+
+      Array<int> A = zeros<int>({20,100,100});
+      for(int i=0; i<20; i++)
+        A(i,i,i) = i;
+
+      H5Storage storage;
+      storage.deflate = 6;
+      storage.shuffle = true;
+      h5write(A, "test.h5", "/compressed", storage);
+      h5flush();
+      REQUIRE( filesize("test.h5") < 100000 );
+
+      h5set_chunk_cache(1 << 22);
+      Array<int> frame = h5read<int>("test.h5", "/compressed", {7});
+      h5set_chunk_cache(0);
+      REQUIRE( frame(7,7) == 7 );
+      REQUIRE( frame(6,6) == 0 );
+
+      storage = H5Storage();
+      storage.chunks = {5,10,10};
+      h5write(A, "test.h5", "/chunked", storage);
+      Array<int> B = h5read<int>("test.h5", "/chunked");
+      REQUIRE( all(equal_mask(A, B)) );
+  }
+
+  TEST_CASE( "numcpp/io/hdf5/cache", "Cached HDF5 handles" ) {
+
+      h5close_all();
+      std::remove("cache.h5");
+
+      // Datasets are added to the file, which stays open.
+      Array<float> A = zeros<float>({2,3});
+      A(1,2) = 5;
+      h5write(A, "cache.h5", "/a");
+      h5write(A.T(), "cache.h5", "/b");
+      REQUIRE( h5read<float>("cache.h5", "/a")(1,2) == 5 );
+      REQUIRE( h5read<float>("./cache.h5", "/b")(2,1) == 5 );
+
+      // Replacing a dataset.
+      h5write(zeros<float>({4}), "cache.h5", "/a");
+      REQUIRE( h5read<float>("cache.h5", "/a").shape() == Shape({4}) );
+
+      h5set_cache_size(2);
+      for(int k=0; k<5; k++)
+        REQUIRE( h5read<float>("cache.h5", k % 2 ? "/a" : "/b").numElements() == (k % 2 ? 4 : 6) );
+      h5set_cache_size(64);
+
+      // Files opened by hand take over from the cache.
+      h5flush();
+      hid_t file = h5open("cache.h5", H5F_ACC_RDONLY);
+      REQUIRE( h5read<float>(file, "/b")(2,1) == 5 );
+      h5close(file);
+
+      h5close_all();
+      REQUIRE_THROWS( h5read<float>("cache.h5", "/missing") );
+  }
+
+  TEST_CASE( "numcpp/io/npy", "npy and npz files" ) {
+
+      Array<double> A = zeros<double>({4,5});
+      for(int i=0; i<4; i++)
+        for(int j=0; j<5; j++)
+          A(i,j) = 10*i+j;
+
+      save_npy("test.npy", A);
+      auto B = load_npy<double>("test.npy");
+      REQUIRE( B.shape() == A.shape() );
+      REQUIRE( B(3,4) == 34 );
+      REQUIRE( (reinterpret_cast<std::uintptr_t>(B.data()) % 64) == 0 );
+      REQUIRE_THROWS( load_npy<float>("test.npy") );
+
+      // Fortran order and strided views.
+      save_npy("test.npy", Array<double>(A.T()));
+      auto C = load_npy<double>("test.npy");
+      REQUIRE( C.isFContiguous() );
+      REQUIRE( C(4,3) == 34 );
+
+      save_npy("test.npy", Array<double>(A[{Slice(0,4,2), Slice(1,5,3)}]));
+      auto D = load_npy<double>("test.npy");
+      REQUIRE( D.shape() == Shape({2,2}) );
+      REQUIRE( D(1,1) == 24 );
+
+      // Strided views of more than maxViewDims dimensions.
+      Array<double> deep = zeros<double>({2,1,1,1,1,1,1,1,1,6});
+      for(int i=0; i<12; i++)
+        deep.data()[i] = i;
+      std::vector<Index> stepped(9, Slice());
+      stepped.push_back(Slice(0,6,2));
+      save_npy("test.npy", Array<double>(deep[stepped]));
+      REQUIRE( load_npy<double>("test.npy")(1,0,0,0,0,0,0,0,0,2) == 10 );
+
+      // Shared mappings write through to the file.
+      save_npy("test.npy", A);
+      {
+        auto M = load_npy<double>("test.npy", MapMode::Shared);
+        REQUIRE( M(2,3) == 23 );
+        M(2,3) = -1;
+      }
+      REQUIRE( load_npy<double>("test.npy", MapMode::Private)(2,3) == -1 );
+
+      // Truncated files throw instead of faulting on access.
+      {
+        std::ifstream in("test.npy", std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream("truncated.npy", std::ios::binary) << bytes.substr(0, bytes.size() - 8);
+        std::ofstream("short.npz", std::ios::binary) << "PK";
+      }
+      REQUIRE_THROWS( load_npy<double>("truncated.npy") );
+      REQUIRE_THROWS( load_npy<double>("truncated.npy", MapMode::Private) );
+      REQUIRE_THROWS( npz_keys("short.npz") );
+
+      {
+        NpzWriter npz("test.npz");
+        npz.add("A", A);
+        npz.add("x", Array<int>(zeros<int>({7})));
+      }
+      REQUIRE( npz_keys("test.npz") == std::vector<std::string>({"A", "x"}) );
+      REQUIRE( load_npz<double>("test.npz", "A")(1,2) == 12 );
+      REQUIRE( load_npz<int>("test.npz", "x", MapMode::Private).shape() == Shape({7}) );
+      REQUIRE_THROWS( load_npz<int>("test.npz", "y") );
+  }
+
+  TEST_CASE( "numcpp/io/loadMatrix", "Row gather from a matrix file" ) {
+
+      Array<int> A = zeros<int>({100,6});
+      for(int i=0; i<100; i++)
+        for(int j=0; j<6; j++)
+          A(i,j) = 10*i+j;
+      tofile(A, "test.dat");
+
+      REQUIRE( loadMatrix<int>("test.dat", 6).shape() == Shape({100,6}) );
+
+      Array<size_t> rows = zeros<size_t>({6});
+      rows(0) = 3; rows(1) = 4; rows(2) = 5; rows(3) = 90; rows(4) = 1; rows(5) = 3;
+
+      IoStats stats;
+      auto B = loadMatrix<int>("test.dat", 6, rows, -1, &stats);
+      REQUIRE( B.shape() == Shape({6,6}) );
+      REQUIRE( B(0,2) == 32 );
+      REQUIRE( B(2,5) == 55 );
+      REQUIRE( B(3,0) == 900 );
+      REQUIRE( B(4,1) == 11 );
+      REQUIRE( B(5,4) == 34 );
+      REQUIRE( stats.requests == 1 );
+      REQUIRE( stats.bytes == 90*6*sizeof(int) );
+
+      // Rows of 3 elements every 12 elements.
+      auto C = loadMatrix<int>("test.dat", 3, Array<size_t>(), 12);
+      REQUIRE( C.shape() == Shape({50,3}) );
+      REQUIRE( C(7,2) == 142 );
+  }
+
+  TEST_CASE( "numcpp/io/stream", "Asynchronous frame reading and writing" ) {
+
+      {
+        FrameWriter<int16_t> writer("frames.dat", 2);
+        for(int k=0; k<5; k++)
+        {
+          Array<int16_t> frame = zeros<int16_t>({2,3});
+          frame(0,0) = k;
+          frame(1,2) = 100+k;
+          writer.write(frame);
+        }
+        // Strided views are written in C order.
+        Array<int16_t> A = zeros<int16_t>({3,2});
+        A(2,1) = 7;
+        writer.write(A.T());
+        writer.close();
+      }
+      REQUIRE( filesize("frames.dat") == 6*6*sizeof(int16_t) );
+
+      FrameStream<int16_t> frames("frames.dat", 6, 2);
+      REQUIRE( frames.numFrames() == 6 );
+
+      std::vector<Array<int16_t> > kept;
+      for(int k=0; k<5; k++)
+      {
+        Array<int16_t> frame = frames.next();
+        REQUIRE( frame.shape() == Shape({6}) );
+        REQUIRE( frame(0) == k );
+        REQUIRE( frame(5) == 100+k );
+        // Holding a frame keeps its buffer out of the ring.
+        if(k == 1)
+          kept.push_back(frame);
+      }
+      REQUIRE( kept[0](5) == 101 );
+
+      Array<int16_t> last = frames.next();
+      REQUIRE( last(5) == 7 );
+      REQUIRE( last(4) == 0 );
+      REQUIRE( frames.next().numElements() == 0 );
+
+      // The documented loop holds a frame while asking for the next one.
+      FrameStream<int16_t> single("frames.dat", 6, 1);
+      int count = 0;
+      for(Array<int16_t> frame = single.next(); frame.numElements() > 0; frame = single.next())
+        count++;
+      REQUIRE( count == 6 );
+  }
+
+  TEST_CASE( "numcpp/io/convert", "Reading with conversion" ) {
+
+      Array<int16_t> A = zeros<int16_t>({300000});
+      for(int i=0; i<300000; i++)
+        A(i) = int16_t(i % 1000 - 500);
+      tofile(A, "test.dat");
+
+      Array<double> B = fromfile<int16_t, double>("test.dat");
+      REQUIRE( B.shape() == Shape({300000}) );
+      REQUIRE( B(0) == -500 );
+      REQUIRE( B(299999) == 499 );
+      REQUIRE( B(123456) == -44 );
+
+      // The same bytes read as big-endian data.
+      Array<float> C = fromfile<int16_t, float>("test.dat", 10, true);
+      REQUIRE( C(1) == int16_t(0x0dfe) );
+
+      Array<size_t> rows = zeros<size_t>({3});
+      rows(0) = 7; rows(1) = 2; rows(2) = 7;
+      auto D = loadMatrix<int16_t, double>("test.dat", 1000, rows);
+      REQUIRE( D.shape() == Shape({3,1000}) );
+      REQUIRE( D(0,3) == -497 );
+      REQUIRE( D(1,999) == 499 );
+      REQUIRE( D(2,0) == -500 );
+
+      auto E = loadMatrix<int16_t, float>("test.dat", 3, rows, 1000, 0, true);
+      REQUIRE( E(1,1) == int16_t(0x0dfe) );
+      REQUIRE( E(2,1) == int16_t(0x0dfe) );
+
+      REQUIRE( (loadMatrix<int16_t, float>("test.dat", 1000).shape() == Shape({300,1000})) );
+  }
+
+  TEST_CASE( "numcpp/io/tofile", "Writing views" ) {
+
+      Array<double> A = zeros<double>({1000,700});
+      for(int i=0; i<1000; i++)
+        for(int j=0; j<700; j++)
+          A(i,j) = 1000*i+j;
+
+      // Gathered through the staging buffer.
+      tofile(A.T(), "test.dat");
+      Array<double> B = loadMatrix<double>("test.dat", 1000);
+      REQUIRE( B.shape() == Shape({700,1000}) );
+      REQUIRE( B(3,2) == 2003 );
+      REQUIRE( B(699,999) == 999699 );
+
+      // Rows written in place.
+      Array<double> rows = A[{Slice(0,1000,3)}];
+      tofile(rows, "test.dat", WriteMode::Direct);
+      B = loadMatrix<double>("test.dat", 700);
+      REQUIRE( B.shape() == Shape({334,700}) );
+      REQUIRE( B(2,5) == 6005 );
+      REQUIRE( B(333,699) == 999699 );
+
+      std::ofstream file("test.dat", std::ios::out|std::ios::binary|std::ios::trunc);
+      tofile(Array<double>(A[{Slice(1,3)}]).T(), file);
+      file.close();
+      B = fromfile<double>("test.dat");
+      REQUIRE( B.numElements() == 1400 );
+      REQUIRE( B(0) == 1000 );
+      REQUIRE( B(1) == 2000 );
+      REQUIRE( B(1399) == 2699 );
+
+      // Strided views of more than maxViewDims dimensions.
+      Array<double> deep = zeros<double>({2,1,1,1,1,1,1,1,1,6});
+      for(int i=0; i<12; i++)
+        deep.data()[i] = i;
+      std::vector<Index> stepped(9, Slice());
+      stepped.push_back(Slice(0,6,2));
+      tofile(Array<double>(deep[stepped]), "test.dat");
+      B = fromfile<double>("test.dat");
+      REQUIRE( B.numElements() == 6 );
+      REQUIRE( B(4) == 8 );
+      REQUIRE( B(5) == 10 );
+  }
+
+  TEST_CASE( "numcpp/io/text", "Text files" ) {
+
+      Array<double> A = zeros<double>({3000,5});
+      for(int i=0; i<3000; i++)
+        for(int j=0; j<5; j++)
+          A(i,j) = (i - 1500) / 7.0 + j;
+
+      savetxt("test.txt", A, ',');
+      Array<double> B = loadtxt<double>("test.txt", ',');
+      REQUIRE( B.shape() == Shape({3000,5}) );
+      REQUIRE( B(0,0) == A(0,0) );
+      REQUIRE( B(1234,3) == A(1234,3) );
+      REQUIRE( B(2999,4) == A(2999,4) );
+
+      // Views, comments and blank lines.
+      Array<int> C = zeros<int>({4,3});
+      for(int i=0; i<12; i++)
+        C(i/3, i%3) = 11*i - 60;
+      savetxt("test.txt", C.T());
+      {
+        std::ofstream file("test.txt", std::ios::app);
+        file << "\n# last row\n  1 2   3 4 # trailing\n";
+      }
+      Array<int> D = loadtxt<int>("test.txt");
+      REQUIRE( D.shape() == Shape({4,4}) );
+      REQUIRE( D(0,1) == -27 );
+      REQUIRE( D(2,3) == 61 );
+      REQUIRE( D(3,2) == 3 );
+
+      savetxt("test.txt", C, ';');
+      Array<long> E = loadtxt<long>("test.txt", ';');
+      REQUIRE( E.shape() == Shape({4,3}) );
+      REQUIRE( E(3,2) == 61 );
+      REQUIRE_THROWS( savetxt("test.txt", Array<int>(C[{1,2}])) );
+
+      // Text views are written without a copy.
+      tofile(Array<int>(C[{Slice(0,4,2), Slice(2,0,-1)}]), "test.txt", ",");
+      {
+        std::ifstream file("test.txt");
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        REQUIRE( text == "-38,-49,28,17," );
+      }
+      std::ofstream("test.txt") << "1 2\n3\n";
+      REQUIRE_THROWS( loadtxt<int>("test.txt") );
+      std::ofstream("test.txt") << "1 x\n";
+      REQUIRE_THROWS( loadtxt<int>("test.txt") );
+
+      // Empty fields and values without a separator.
+      std::ofstream("test.txt") << "1, 2 ,3\n4,5,6\n";
+      REQUIRE( loadtxt<int>("test.txt", ',')(1,2) == 6 );
+      std::ofstream("test.txt") << "1,,3\n4,5,6\n";
+      REQUIRE_THROWS( loadtxt<int>("test.txt", ',') );
+      std::ofstream("test.txt") << "1,2,\n";
+      REQUIRE_THROWS( loadtxt<int>("test.txt", ',') );
+      std::ofstream("test.txt") << "1-2 3\n";
+      REQUIRE_THROWS( loadtxt<int>("test.txt") );
+      std::ofstream("test.txt") << "1.5e3x,2\n";
+      REQUIRE_THROWS( loadtxt<double>("test.txt", ',') );
   }
@@ -0,0 +1,72 @@
+// The NumPy C API table lives in this file; numpy.h only declares it.
+#define PY_ARRAY_UNIQUE_SYMBOL numcpp_ARRAY_API
+#include <numpy/arrayobject.h>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include <numcpp/numpy.h>
+
+using namespace numcpp;
+
+static void initNumpy()
+{
+  if(!Py_IsInitialized())
+    Py_Initialize();
+  if(_import_array() < 0)
+    FAIL( "cannot import numpy" );
+}
+
+TEST_CASE( "numcpp/numpy/from_numpy", "Zero-copy from NumPy" )
+{
+  initNumpy();
+
+  npy_intp dims[] = {3, 4};
+  PyArrayObject* pyarray = (PyArrayObject*)PyArray_ZEROS(2, dims, NPY_DOUBLE, 0);
+  PyArrayObject* pytransposed = (PyArrayObject*)PyArray_Transpose(pyarray, NULL);
+  REQUIRE( Py_REFCNT(pytransposed) == 1 );
+
+  {
+    Array<double> x = from_numpy<double>(pytransposed);
+    REQUIRE( x.shape() == Shape({4,3}) );
+    REQUIRE( Py_REFCNT(pytransposed) == 2 );
+
+    x(3,1) = 5;
+    REQUIRE( *(double*)PyArray_GETPTR2(pyarray, 1, 3) == 5 );
+  }
+  REQUIRE( Py_REFCNT(pytransposed) == 1 );
+
+  Array<float> y = cast_from_numpy<float>(pyarray);
+  REQUIRE( y(1,3) == 5 );
+
+  REQUIRE_THROWS( from_numpy<int>(pyarray) );
+
+  Py_DECREF(pytransposed);
+  Py_DECREF(pyarray);
+}
+
+TEST_CASE( "numcpp/numpy/to_numpy", "Zero-copy to NumPy" )
+{
+  initNumpy();
+
+  Array<int> x = zeros<int>({4,6});
+  Array<int> column = x.T()[{Slice(1,3)}];
+  PyArrayObject* pyarray = to_numpy(column);
+
+  REQUIRE( PyArray_NDIM(pyarray) == 2 );
+  REQUIRE( PyArray_DIM(pyarray, 0) == 2 );
+  REQUIRE( PyArray_DIM(pyarray, 1) == 4 );
+  REQUIRE( PyArray_STRIDE(pyarray, 0) == 4 );
+  REQUIRE( PyArray_STRIDE(pyarray, 1) == 24 );
+
+  *(int*)PyArray_GETPTR2(pyarray, 1, 3) = 7;
+  REQUIRE( x(3,2) == 7 );
+
+  // The buffer outlives the numcpp arrays.
+  long count = x.useCount();
+  column = Array<int>();
+  x = Array<int>();
+  REQUIRE( count == 3 );
+  REQUIRE( *(int*)PyArray_GETPTR2(pyarray, 1, 3) == 7 );
+
+  Py_DECREF(pyarray);
+}